@@ -0,0 +1,393 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "myOpenGL/camera.h"
+#include "myOpenGL/command_bucket.h"
+#include "myOpenGL/instance_buffer.h"
+#include "myOpenGL/shader.h"
+#include "myOpenGL/shader_parameters.h"
+#ifdef VSM_HEADLESS
+#include "myOpenGL/egl_context.h"
+#include "myOpenGL/gl_state.h"
+#endif
+#include "vsm_scene.h"
+
+// Microbenchmarks of the CPU work of a frame: camera updates, the matrices render() builds, command recording and
+// sorting, and uniform writes. Frame times are bound by the GPU, so changes to these paths do not show up there.
+// Every benchmark reports its heap allocations per iteration next to the time. The uniform benchmarks need a GL
+// context, they run on the headless context and are skipped in builds without EGL.
+
+// Every allocation of the process is counted: all forms of operator new are replaced and route to countedAllocate,
+// the aligned ones included, and every operator delete frees with std::free to match.
+static std::atomic<unsigned long long> allocationCount(0);
+
+static void* countedAllocate(std::size_t size, std::size_t alignment)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size = size != 0 ? size : 1;
+    if (alignment <= alignof(std::max_align_t))
+        return std::malloc(size);
+    // aligned_alloc wants a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+static void* countedAllocateOrThrow(std::size_t size, std::size_t alignment)
+{
+    if (void* memory = countedAllocate(size, alignment))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size)
+{
+    return countedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocateOrThrow(size, (std::size_t)alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocateOrThrow(size, (std::size_t)alignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size, (std::size_t)alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size, (std::size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+// counts the allocations from construction until report(), create it right before the benchmark loop
+class AllocationCounter
+{
+public:
+    AllocationCounter() : start(allocationCount.load(std::memory_order_relaxed))
+    {
+    }
+    void report(benchmark::State& state) const
+    {
+        double allocations = double(allocationCount.load(std::memory_order_relaxed) - start);
+        state.counters["allocs/op"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    unsigned long long start;
+};
+
+// the renderer's light and camera defaults
+const glm::vec3 LIGHT_POSITION = glm::vec3(8.0f, 4.0f, 5.0f);
+const int SCREEN_WIDTH = 1280;
+const int SCREEN_HEIGHT = 720;
+
+// set by main when the headless context came up
+static bool glContextAvailable = false;
+
+// camera
+// ------------------------------------------------------------------------
+static void BM_CameraViewMatrix(benchmark::State& state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 5.0f));
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(camera);
+        glm::mat4 view = camera.GetViewMatrix();
+        benchmark::DoNotOptimize(view);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_CameraViewMatrix);
+
+// one mouse event, recomputes the camera vectors
+static void BM_CameraMouseMovement(benchmark::State& state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 5.0f));
+    float direction = 1.0f;
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        // back and forth, so the pitch is not stuck at the constraint
+        direction = -direction;
+        camera.ProcessMouseMovement(3.0f * direction, 2.0f * direction);
+        benchmark::DoNotOptimize(camera.Front);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_CameraMouseMovement);
+
+// matrices
+// ------------------------------------------------------------------------
+// what render() builds every frame: the camera view and projection and the light view and projection
+static void BM_FrameMatrices(benchmark::State& state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 5.0f));
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(camera);
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 lightView = lightViewMatrix(LIGHT_POSITION);
+        glm::mat4 lightProjection = lightProjectionMatrix(1024, 1024, 0.1f, 20.0f);
+        benchmark::DoNotOptimize(view);
+        benchmark::DoNotOptimize(projection);
+        benchmark::DoNotOptimize(lightView);
+        benchmark::DoNotOptimize(lightProjection);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_FrameMatrices);
+
+// model matrices of the whole scene
+static void BM_PillarTransforms(benchmark::State& state)
+{
+    int pillarCount = (int)state.range(0);
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        std::vector<glm::mat4> transforms = pillarTransforms(pillarCount);
+        benchmark::DoNotOptimize(transforms.data());
+    }
+    allocations.report(state);
+    state.SetItemsProcessed(state.iterations() * pillarCount);
+}
+BENCHMARK(BM_PillarTransforms)->Arg(5)->Arg(100)->Arg(1000);
+
+// the normal matrix of an instance, once with a uniform scale and once with a general one
+static void BM_NormalMatrix(benchmark::State& state)
+{
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), 0.7f, glm::vec3(0.2f, 1.0f, 0.1f));
+    model = state.range(0) != 0 ? glm::scale(model, glm::vec3(1.0f, 2.0f, 0.5f)) : glm::scale(model, glm::vec3(2.0f));
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(model);
+        glm::mat3 normalMatrix = InstanceBuffer::normalMatrix(model);
+        benchmark::DoNotOptimize(normalMatrix);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_NormalMatrix)->ArgName("nonuniform")->Arg(0)->Arg(1);
+
+// command bucket
+// ------------------------------------------------------------------------
+// records and sorts a frame of single instance draws over two passes, four programs and eight materials, the
+// bucket is reused across frames the way the renderer does
+static void BM_CommandBucketRecordSort(benchmark::State& state)
+{
+    int commandCount = (int)state.range(0);
+    Shader shaders[4];
+    for (int i = 0; i < 4; i++)
+        shaders[i].ID = i + 1;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+    std::vector<float> depths(commandCount);
+    for (float& value : depths)
+        value = depth(random);
+
+    CommandBucket bucket;
+    RenderCommand command = {};
+    command.instanceCount = 1;
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        bucket.clear();
+        for (int i = 0; i < commandCount; i++)
+        {
+            command.shader = &shaders[i % 4];
+            command.material = i % 8;
+            bucket.record(0, CommandBucket::makeKey(i % 2, *command.shader, command.material, 1 + i % 3, depths[i]), command);
+        }
+        bucket.sort();
+        benchmark::DoNotOptimize(bucket.size());
+    }
+    allocations.report(state);
+    state.SetItemsProcessed(state.iterations() * commandCount);
+}
+BENCHMARK(BM_CommandBucketRecordSort)->RangeMultiplier(8)->Range(64, 32768);
+
+// uniforms
+// ------------------------------------------------------------------------
+const char* UNIFORM_VERTEX_SHADER =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "uniform mat4 model;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 projection;\n"
+    "uniform mat3 normalMatrix;\n"
+    "out vec3 normal;\n"
+    "void main()\n"
+    "{\n"
+    "    normal = normalMatrix * aPos;\n"
+    "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+    "}\n";
+const char* UNIFORM_FRAGMENT_SHADER =
+    "#version 330 core\n"
+    "in vec3 normal;\n"
+    "uniform vec3 lightPos;\n"
+    "uniform float shininess;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    FragColor = vec4(normalize(normal) * lightPos * shininess, 1.0);\n"
+    "}\n";
+
+// a program with the uniforms of a typical draw, compiled once
+static Shader& uniformShader()
+{
+    static std::unique_ptr<Shader> shader(new Shader(ShaderSources::fromCode(UNIFORM_VERTEX_SHADER, UNIFORM_FRAGMENT_SHADER)));
+    shader->use();
+    return *shader;
+}
+
+// the per-instance uniforms of a draw through Shader, by name
+static void BM_ShaderSetUniforms(benchmark::State& state)
+{
+    if (!glContextAvailable)
+    {
+        state.SkipWithError("no GL context");
+        return;
+    }
+    Shader& shader = uniformShader();
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 2.0f));
+    glm::mat3 normalMatrix = InstanceBuffer::normalMatrix(model);
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        shader.setMat4("model", model);
+        shader.setMat3("normalMatrix", normalMatrix);
+        shader.setVec3("lightPos", LIGHT_POSITION);
+        shader.setFloat("shininess", 32.0f);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_ShaderSetUniforms);
+
+// the same through ShaderParameters by slot; with changed values every upload writes, with unchanged ones it
+// only compares
+static void BM_ShaderParametersUpload(benchmark::State& state)
+{
+    if (!glContextAvailable)
+    {
+        state.SkipWithError("no GL context");
+        return;
+    }
+    bool changing = state.range(0) != 0;
+    Shader& shader = uniformShader();
+    ShaderParameters parameters(shader);
+    int modelSlot = parameters.find("model");
+    int normalSlot = parameters.find("normalMatrix");
+    int lightSlot = parameters.find("lightPos");
+    int shininessSlot = parameters.find("shininess");
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 2.0f));
+    float offset = 0.0f;
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        if (changing)
+            offset += 1.0f;
+        model[3].x = offset;
+        parameters.set(modelSlot, model);
+        parameters.set(normalSlot, glm::mat3(model));
+        parameters.set(lightSlot, LIGHT_POSITION);
+        parameters.set(shininessSlot, 32.0f);
+        parameters.upload();
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_ShaderParametersUpload)->ArgName("changing")->Arg(0)->Arg(1);
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+#ifdef VSM_HEADLESS
+    EglContext context;
+    if (context.create(3, 3) && gladLoadGLLoader((GLADloadproc)EglContext::getProcAddress))
+    {
+        GLState::current().invalidate();
+        glContextAvailable = true;
+    }
+    else
+        std::cout << "ERROR::BENCHMARK::NO_GL_CONTEXT: the uniform benchmarks are skipped" << std::endl;
+#endif
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+#ifdef VSM_HEADLESS
+    context.destroy();
+#endif
+    return 0;
+}
@@ -0,0 +1,124 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+
+// camera state at a point of a recording, seconds since its start
+struct CameraPose
+{
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+// A recorded camera flight for reproducible runs. The recorder stores the camera once per frame with its wall
+// clock time; replay samples the path at fixed timesteps, so every run renders the same poses however long its
+// frames take. The file is an 8 byte tag and the pose count, then each pose as seven floats in native byte order.
+class CameraPath
+{
+public:
+    std::vector<CameraPose> Poses;
+
+    void record(const Camera& camera, float time)
+    {
+        Poses.push_back(CameraPose{time, camera.Position, camera.Yaw, camera.Pitch, camera.Zoom});
+    }
+
+    float duration() const
+    {
+        return Poses.empty() ? 0.0f : Poses.back().time;
+    }
+    // frames a replay at the timestep takes to reach the end of the path
+    int frameCount(float timestep) const
+    {
+        return (int)(duration() / timestep) + 1;
+    }
+
+    // the pose at a time, interpolated between the recorded ones and held at both ends
+    CameraPose sample(float time) const
+    {
+        if (Poses.empty())
+            return CameraPose{time, glm::vec3(0.0f), -90.0f, 0.0f, 45.0f};
+        if (time <= Poses.front().time)
+            return Poses.front();
+        if (time >= Poses.back().time)
+            return Poses.back();
+        // poses are ordered by time, the first one not before the time ends the segment
+        auto next = std::lower_bound(Poses.begin() + 1, Poses.end(), time, [](const CameraPose& pose, float value) { return pose.time < value; });
+        const CameraPose& a = *(next - 1);
+        const CameraPose& b = *next;
+        float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 1.0f;
+        return CameraPose{time, glm::mix(a.position, b.position, t), glm::mix(a.yaw, b.yaw, t), glm::mix(a.pitch, b.pitch, t), glm::mix(a.zoom, b.zoom, t)};
+    }
+    // moves the camera to the pose of the frame at a fixed timestep
+    void apply(Camera& camera, int frame, float timestep) const
+    {
+        CameraPose pose = sample(frame * timestep);
+        camera.SetPose(pose.position, pose.yaw, pose.pitch, pose.zoom);
+    }
+
+    bool save(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::CAMERA_PATH::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        uint32_t count = (uint32_t)Poses.size();
+        file.write(magic(), MAGIC_SIZE);
+        file.write((const char*)&count, sizeof(count));
+        for (const CameraPose& pose : Poses)
+        {
+            float values[POSE_FLOATS] = {pose.time, pose.position.x, pose.position.y, pose.position.z, pose.yaw, pose.pitch, pose.zoom};
+            file.write((const char*)values, sizeof(values));
+        }
+        return (bool)file;
+    }
+
+    bool load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        char header[MAGIC_SIZE] = {};
+        uint32_t count = 0;
+        if (!file.read(header, MAGIC_SIZE) || std::memcmp(header, magic(), MAGIC_SIZE) != 0 || !file.read((char*)&count, sizeof(count)))
+        {
+            std::cout << "ERROR::CAMERA_PATH::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+        Poses.clear();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float values[POSE_FLOATS];
+            if (!file.read((char*)values, sizeof(values)))
+            {
+                std::cout << "ERROR::CAMERA_PATH::TRUNCATED: " << path << std::endl;
+                return false;
+            }
+            Poses.push_back(CameraPose{values[0], glm::vec3(values[1], values[2], values[3]), values[4], values[5], values[6]});
+        }
+        return !Poses.empty();
+    }
+
+private:
+    // file format identifier and version, without the terminator
+    static const int MAGIC_SIZE = 8;
+    static const int POSE_FLOATS = 7;
+    static const char* magic()
+    {
+        return "VSMCAM01";
+    }
+};
+#endif
@@ -0,0 +1,213 @@
+#ifndef COMMAND_BUCKET_H
+#define COMMAND_BUCKET_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "shader_parameters.h"
+#include "geometry_buffer.h"
+#include "instance_buffer.h"
+#include "multi_draw.h"
+
+// A recorded draw. It only points at data that stays untouched until the bucket is submitted, so recording
+// needs no GL context. One of three kinds:
+// - batch set: the whole MultiDrawBatch over geometry
+// - instance set: one draw of mesh with the model and normalMatrix uniforms of that instance
+// - neither: instanceCount instances of mesh, the instance attributes come from the vertex array
+struct RenderCommand
+{
+    Shader* shader;
+    ShaderParameters* parameters;
+    const GeometryBuffer* geometry;
+    int mesh;
+    bool positionOnly;
+    GLsizei instanceCount;
+    const InstanceData* instance;
+    MultiDrawBatch* batch;
+    uint32_t material;
+};
+
+// Draws are recorded with a 64-bit sort key into per-thread buffers, radix-sorted, and submitted pass by pass
+// from the GL thread. The key orders by pass, program, material, vertex array and finally depth, so state only
+// changes between runs of equal commands and each run is drawn front to back for early depth rejection.
+// Each thread records into its own buffer: record() is safe as long as no two threads share a thread index.
+class CommandBucket
+{
+public:
+    static const int PASS_BITS = 8;
+    static const int PROGRAM_BITS = 12;
+    static const int MATERIAL_BITS = 12;
+    static const int VERTEX_ARRAY_BITS = 12;
+    static const int DEPTH_BITS = 20;
+
+    // applies a material to the parameters of the command, called on material changes during submit()
+    std::function<void(ShaderParameters&, uint32_t)> BindMaterial;
+
+    CommandBucket(int threadCount = 1) : threads(threadCount)
+    {
+    }
+
+    // depth is the normalized view distance, values outside [0, 1] are clamped
+    // ------------------------------------------------------------------------
+    static uint64_t makeKey(unsigned int pass, const Shader& shader, uint32_t material, unsigned int vertexArray, float depth)
+    {
+        unsigned int program = shader.Pipeline != 0 ? shader.Pipeline : shader.ID;
+        depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+        uint64_t key = pass & mask(PASS_BITS);
+        key = (key << PROGRAM_BITS) | (program & mask(PROGRAM_BITS));
+        key = (key << MATERIAL_BITS) | (material & mask(MATERIAL_BITS));
+        key = (key << VERTEX_ARRAY_BITS) | (vertexArray & mask(VERTEX_ARRAY_BITS));
+        key = (key << DEPTH_BITS) | (uint64_t)(depth * mask(DEPTH_BITS));
+        return key;
+    }
+    static unsigned int passOf(uint64_t key)
+    {
+        return (unsigned int)(key >> (64 - PASS_BITS));
+    }
+
+    void record(int thread, uint64_t key, const RenderCommand& command)
+    {
+        ThreadBuffer& buffer = threads[thread];
+        buffer.keys.push_back(key);
+        buffer.commands.push_back(command);
+    }
+
+    // drops the recorded commands, the memory is kept for the next frame
+    void clear()
+    {
+        for (ThreadBuffer& buffer : threads)
+        {
+            buffer.keys.clear();
+            buffer.commands.clear();
+        }
+        sorted.clear();
+        commands.clear();
+    }
+
+    // gathers the thread buffers and sorts them by key, recording has to be finished
+    // ------------------------------------------------------------------------
+    void sort()
+    {
+        sorted.clear();
+        commands.clear();
+        for (ThreadBuffer& buffer : threads)
+        {
+            for (size_t i = 0; i < buffer.keys.size(); i++)
+                sorted.push_back(Entry{buffer.keys[i], (uint32_t)commands.size() + (uint32_t)i});
+            commands.insert(commands.end(), buffer.commands.begin(), buffer.commands.end());
+        }
+        radixSort();
+    }
+
+    // issues the sorted commands of one pass, the render target of the pass has to be bound
+    // ------------------------------------------------------------------------
+    void submit(unsigned int pass)
+    {
+        GLState& state = GLState::current();
+        Shader* shader = nullptr;
+        ShaderParameters* parameters = nullptr;
+        uint32_t material = 0xFFFFFFFFu;
+        // slots of the instance uniforms, looked up once per run of commands with the same parameters
+        int modelSlot = -1;
+        int normalMatrixSlot = -1;
+        // the pass is the top of the key, so its commands are one run of the sorted entries
+        auto keyLess = [](const Entry& entry, uint64_t key) { return entry.key < key; };
+        uint64_t passKey = uint64_t(pass & mask(PASS_BITS)) << (64 - PASS_BITS);
+        auto first = std::lower_bound(sorted.begin(), sorted.end(), passKey, keyLess);
+        auto last = pass + 1 > mask(PASS_BITS) ? sorted.end() : std::lower_bound(first, sorted.end(), passKey + (uint64_t(1) << (64 - PASS_BITS)), keyLess);
+        for (auto it = first; it != last; ++it)
+        {
+            const Entry& entry = *it;
+            const RenderCommand& command = commands[entry.command];
+            if (command.shader != shader)
+            {
+                shader = command.shader;
+                shader->use();
+                material = 0xFFFFFFFFu;
+            }
+            if (command.parameters != parameters)
+            {
+                parameters = command.parameters;
+                modelSlot = parameters->find("model");
+                normalMatrixSlot = parameters->find("normalMatrix");
+            }
+            if (command.material != material && BindMaterial)
+            {
+                material = command.material;
+                BindMaterial(*command.parameters, material);
+            }
+            if (command.batch != nullptr)
+            {
+                command.parameters->upload();
+                command.batch->draw(*command.geometry, command.positionOnly);
+                continue;
+            }
+            state.bindVertexArray(command.geometry->vertexArray(command.positionOnly));
+            if (command.instance != nullptr)
+            {
+                command.parameters->set(modelSlot, command.instance->model);
+                command.parameters->set(normalMatrixSlot, command.instance->normalMatrix);
+            }
+            command.parameters->upload();
+            command.geometry->draw(command.mesh, command.instanceCount);
+        }
+    }
+
+    size_t size() const
+    {
+        return sorted.size();
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t command;
+    };
+    struct ThreadBuffer
+    {
+        std::vector<uint64_t> keys;
+        std::vector<RenderCommand> commands;
+    };
+
+    std::vector<ThreadBuffer> threads;
+    std::vector<RenderCommand> commands;
+    std::vector<Entry> sorted;
+    std::vector<Entry> scratch;
+
+    static uint64_t mask(int bits)
+    {
+        return (uint64_t(1) << bits) - 1;
+    }
+
+    // least significant digit first, one byte per pass; bytes that are equal for every key are skipped
+    void radixSort()
+    {
+        scratch.resize(sorted.size());
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            size_t counts[256] = {0};
+            for (const Entry& entry : sorted)
+                counts[(entry.key >> shift) & 0xFF]++;
+            if (counts[(sorted.empty() ? 0 : sorted[0].key >> shift) & 0xFF] == sorted.size())
+                continue;
+            size_t offset = 0;
+            for (size_t& count : counts)
+            {
+                size_t next = offset + count;
+                count = offset;
+                offset = next;
+            }
+            for (const Entry& entry : sorted)
+                scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+            sorted.swap(scratch);
+        }
+    }
+};
+#endif
@@ -0,0 +1,284 @@
+#ifndef CPU_TRACE_H
+#define CPU_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// a traced scope, timestamps in nanoseconds of the steady clock
+struct TraceEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Scoped CPU markers for every thread of the frame loop, written as Chrome trace-event JSON that chrome://tracing
+// and Perfetto open. Each thread appends to a buffer of its own without locks, only the first event of a thread
+// and the export take the registry lock; a buffer of a finished thread is handed to the next new thread, so
+// short-lived workers share tracks. GPU scopes converted to the steady clock go to a track of their own.
+// Recording is off until enabled, a Scope costs one atomic load then.
+class CpuTrace
+{
+public:
+    // events kept per thread, later ones are dropped
+    static const size_t CHUNK_EVENTS = 4096;
+    static const size_t MAX_CHUNKS = 256;
+
+    // times the enclosing block, the name has to outlive the trace, e.g. a string literal or intern()
+    class Scope
+    {
+    public:
+        Scope(const char* name) : name(name), begin(CpuTrace::global().enabled() ? now() : 0)
+        {
+        }
+        ~Scope()
+        {
+            if (begin != 0)
+                CpuTrace::global().record(name, begin, now());
+        }
+
+    private:
+        const char* name;
+        uint64_t begin;
+    };
+
+    static CpuTrace& global()
+    {
+        static CpuTrace trace;
+        return trace;
+    }
+    static uint64_t now()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void setEnabled(bool enabled)
+    {
+        recording.store(enabled, std::memory_order_relaxed);
+    }
+    bool enabled() const
+    {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    // the track name of the calling thread
+    void setThreadName(const std::string& name)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.name = name;
+    }
+
+    // a stable copy of a name that is not a literal, e.g. of a render pass; cached per thread after the first call
+    const char* intern(const std::string& name)
+    {
+        thread_local std::unordered_map<std::string, const char*> cache;
+        auto cached = cache.find(name);
+        if (cached != cache.end())
+            return cached->second;
+        std::lock_guard<std::mutex> lock(mutex);
+        const char* stable = names.insert(name).first->c_str();
+        cache.emplace(name, stable);
+        return stable;
+    }
+
+    // begin and end of scopes that are not a block, e.g. the hooks around a render pass; they nest per thread
+    // and always pair up, the scope is kept if recording is on at its end
+    void begin(const char* name)
+    {
+        threadBuffer().open.push_back(TraceEvent{name, now(), 0});
+    }
+    void end()
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        if (buffer.open.empty())
+            return;
+        TraceEvent event = buffer.open.back();
+        buffer.open.pop_back();
+        event.end = now();
+        if (enabled())
+            buffer.append(event);
+    }
+
+    void record(const char* name, uint64_t begin, uint64_t end)
+    {
+        threadBuffer().append(TraceEvent{name, begin, end});
+    }
+    // a GPU scope already converted to the steady clock, only the thread owning the GL context records them
+    void recordGpu(const char* name, uint64_t begin, uint64_t end)
+    {
+        if (enabled())
+            gpu.append(TraceEvent{name, begin, end});
+    }
+
+    // every event so far as Chrome trace-event JSON, threads may keep recording meanwhile
+    // ------------------------------------------------------------------------
+    bool writeChromeTrace(const std::string& path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::CPU_TRACE::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        // microseconds with nanosecond digits, a long trace would lose them to the default precision
+        file << std::fixed << std::setprecision(3);
+        std::lock_guard<std::mutex> lock(mutex);
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+        bool first = true;
+        size_t written = 0;
+        size_t dropped = 0;
+        for (size_t i = 0; i <= threads.size(); i++)
+        {
+            const ThreadBuffer& buffer = i < threads.size() ? *threads[i] : gpu;
+            file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.id
+                << ", \"args\": {\"name\": \"" << escape(buffer.name.c_str()) << "\"}}";
+            first = false;
+            size_t count = buffer.count.load(std::memory_order_acquire);
+            for (size_t index = 0; index < count; index++)
+            {
+                const TraceEvent& event = buffer.event(index);
+                file << ",\n{\"name\": \"" << escape(event.name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer.id
+                    << ", \"ts\": " << microseconds(event.begin) << ", \"dur\": " << (event.end - event.begin) / 1000.0 << "}";
+            }
+            written += count;
+            dropped += buffer.dropped.load(std::memory_order_relaxed);
+        }
+        file << std::endl << "]}" << std::endl;
+        std::cout << "trace: " << written << " events written to " << path;
+        if (dropped > 0)
+            std::cout << ", " << dropped << " dropped";
+        std::cout << std::endl;
+        return true;
+    }
+
+    // text for a JSON string literal, quotes, backslashes and control characters escaped
+    static std::string escape(const char* text)
+    {
+        std::string escaped;
+        for (const char* character = text; *character != '\0'; character++)
+        {
+            if ((unsigned char)*character < 0x20)
+            {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", (unsigned char)*character);
+                escaped += code;
+                continue;
+            }
+            if (*character == '"' || *character == '\\')
+                escaped += '\\';
+            escaped += *character;
+        }
+        return escaped;
+    }
+
+private:
+    // written by one thread, read by the exporter up to the published count; chunks are never moved or freed
+    struct ThreadBuffer
+    {
+        int id = 0;
+        std::string name;
+        std::atomic<TraceEvent*> chunks[MAX_CHUNKS] = {};
+        std::atomic<size_t> count{0};
+        std::atomic<size_t> dropped{0};
+        // begin() without end() yet, only touched by the owning thread
+        std::vector<TraceEvent> open;
+
+        ~ThreadBuffer()
+        {
+            for (std::atomic<TraceEvent*>& chunk : chunks)
+                delete[] chunk.load();
+        }
+        void append(const TraceEvent& event)
+        {
+            size_t index = count.load(std::memory_order_relaxed);
+            size_t chunk = index / CHUNK_EVENTS;
+            if (chunk >= MAX_CHUNKS)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            TraceEvent* events = chunks[chunk].load(std::memory_order_relaxed);
+            if (events == nullptr)
+            {
+                events = new TraceEvent[CHUNK_EVENTS];
+                chunks[chunk].store(events, std::memory_order_release);
+            }
+            events[index % CHUNK_EVENTS] = event;
+            count.store(index + 1, std::memory_order_release);
+        }
+        const TraceEvent& event(size_t index) const
+        {
+            return chunks[index / CHUNK_EVENTS].load(std::memory_order_acquire)[index % CHUNK_EVENTS];
+        }
+    };
+    // gives the buffer back when its thread exits
+    struct ThreadSlot
+    {
+        ThreadBuffer* buffer = nullptr;
+        ~ThreadSlot()
+        {
+            if (buffer != nullptr)
+                CpuTrace::global().releaseBuffer(buffer);
+        }
+    };
+
+    std::atomic<bool> recording{false};
+    uint64_t epoch = now();
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    std::vector<ThreadBuffer*> freeBuffers;
+    ThreadBuffer gpu;
+    std::set<std::string> names;
+
+    CpuTrace()
+    {
+        gpu.id = 0;
+        gpu.name = "GPU";
+    }
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadSlot slot;
+        if (slot.buffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!freeBuffers.empty())
+            {
+                slot.buffer = freeBuffers.back();
+                freeBuffers.pop_back();
+            }
+            else
+            {
+                threads.emplace_back(new ThreadBuffer());
+                slot.buffer = threads.back().get();
+                slot.buffer->id = (int)threads.size();
+                slot.buffer->name = "thread " + std::to_string(threads.size());
+            }
+        }
+        return *slot.buffer;
+    }
+    void releaseBuffer(ThreadBuffer* buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer->open.clear();
+        freeBuffers.push_back(buffer);
+    }
+
+    double microseconds(uint64_t time) const
+    {
+        return time >= epoch ? (time - epoch) / 1000.0 : -((epoch - time) / 1000.0);
+    }
+};
+#endif
@@ -0,0 +1,125 @@
+#ifndef EGL_CONTEXT_H
+#define EGL_CONTEXT_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+// An OpenGL core profile context without a window, for machines without a display or GPU, e.g. Mesa llvmpipe.
+// The display is surfaceless where Mesa offers it, the default display otherwise. The context is made current
+// without a surface when EGL_KHR_surfaceless_context is there, with a 1x1 pbuffer if not; either way rendering
+// has to go into framebuffer objects.
+class EglContext
+{
+public:
+    EGLDisplay Display = EGL_NO_DISPLAY;
+    EGLContext Context = EGL_NO_CONTEXT;
+    EGLSurface Surface = EGL_NO_SURFACE;
+
+    // creates the context and makes it current, the version is a minimum; a debug context reports more KHR_debug messages
+    // ------------------------------------------------------------------------
+    bool create(int major, int minor, bool debug = false)
+    {
+        Display = surfacelessDisplay();
+        if (Display == EGL_NO_DISPLAY)
+            Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint eglMajor, eglMinor;
+        if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &eglMajor, &eglMinor))
+            return fail("NO_DISPLAY");
+        if (!eglBindAPI(EGL_OPENGL_API))
+            return fail("NO_OPENGL_API");
+
+        EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(Display, configAttributes, &config, 1, &configCount) || configCount == 0)
+            return fail("NO_CONFIG");
+
+        EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION_KHR, major,
+            EGL_CONTEXT_MINOR_VERSION_KHR, minor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+            EGL_CONTEXT_FLAGS_KHR, debug ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0,
+            EGL_NONE
+        };
+        Context = eglCreateContext(Display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (Context == EGL_NO_CONTEXT)
+            return fail("CONTEXT_CREATION_FAILED");
+
+        if (!hasExtension("EGL_KHR_surfaceless_context"))
+        {
+            EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            Surface = eglCreatePbufferSurface(Display, config, surfaceAttributes);
+            if (Surface == EGL_NO_SURFACE)
+                return fail("NO_SURFACE");
+        }
+        if (!eglMakeCurrent(Display, Surface, Surface, Context))
+            return fail("MAKE_CURRENT_FAILED");
+        return true;
+    }
+
+    void destroy()
+    {
+        if (Display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (Surface != EGL_NO_SURFACE)
+            eglDestroySurface(Display, Surface);
+        if (Context != EGL_NO_CONTEXT)
+            eglDestroyContext(Display, Context);
+        eglTerminate(Display);
+        Display = EGL_NO_DISPLAY;
+        Context = EGL_NO_CONTEXT;
+        Surface = EGL_NO_SURFACE;
+    }
+
+    // loader for glad, core functions included (EGL 1.5, EGL_KHR_get_all_proc_addresses)
+    static void* getProcAddress(const char* name)
+    {
+        return (void*)eglGetProcAddress(name);
+    }
+
+private:
+    bool hasExtension(const char* name) const
+    {
+        const char* extensions = eglQueryString(Display, EGL_EXTENSIONS);
+        return extensions != nullptr && containsWord(extensions, name);
+    }
+    static bool containsWord(const char* list, const char* word)
+    {
+        size_t length = std::strlen(word);
+        for (const char* found = std::strstr(list, word); found != nullptr; found = std::strstr(found + 1, word))
+            if ((found == list || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+                return true;
+        return false;
+    }
+
+    // the Mesa surfaceless platform needs no window system at all
+    static EGLDisplay surfacelessDisplay()
+    {
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (clientExtensions == nullptr || !containsWord(clientExtensions, "EGL_MESA_platform_surfaceless"))
+            return EGL_NO_DISPLAY;
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay == nullptr)
+            return EGL_NO_DISPLAY;
+        return getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    bool fail(const char* reason)
+    {
+        std::cout << "ERROR::EGL_CONTEXT::" << reason << " (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        destroy();
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,225 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+
+// what one frame asked of GL
+struct FrameCounters
+{
+    unsigned int drawCalls = 0;
+    unsigned long long triangles = 0;
+    // binds that reached GL, redundant ones dropped by GLState are not counted
+    unsigned int programBinds = 0;
+    unsigned int framebufferBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int uniformUploads = 0;
+    // buffer data and uniform values handed to GL
+    unsigned long long bytesUploaded = 0;
+};
+
+// Frame times and per-frame GL counters of the current context, the first thing to look at when frames stutter.
+// A frame lasts from one beginFrame() to the next, so it covers everything the loop does, the swap included.
+// The times of the last HISTORY frames are kept in a histogram that is updated as frames enter and leave the
+// window, percentiles are read from it without sorting. Bucket edges grow by BUCKET_GROWTH from FIRST_BUCKET_MS,
+// so a percentile is within 2.5% of the true time from a fraction of a millisecond up to seconds; the maximum is
+// exact. Draw, upload and uniform counts are reported by the helpers that issue them, the binds come from the
+// issued calls of GLState.
+class FrameStats
+{
+public:
+    // frames the rolling statistics cover
+    static const int HISTORY = 600;
+    static const int BUCKET_COUNT = 512;
+    static constexpr double FIRST_BUCKET_MS = 0.05;
+    static constexpr double BUCKET_GROWTH = 1.025;
+
+    // the counters of the frame being recorded
+    FrameCounters Counters;
+    // seconds between log lines, 0 turns them off
+    double LogInterval = 0.0;
+
+    // the stats of the current context, the renderer uses a single context
+    static FrameStats& current()
+    {
+        static FrameStats stats;
+        return stats;
+    }
+
+    FrameStats()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(buckets, buckets + BUCKET_COUNT, 0);
+        Counters = FrameCounters();
+        lastCounters = FrameCounters();
+        frameCount = 0;
+        next = 0;
+        frameOpen = false;
+        sinceLog = 0.0;
+        loggedFrames = 0;
+        capture(GLState::current());
+    }
+
+    // closes the previous frame and starts a new one
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        GLState& state = GLState::current();
+        if (frameOpen)
+        {
+            Counters.programBinds = state.Issued[GLState::PROGRAM] + state.Issued[GLState::PIPELINE] - issuedPrograms;
+            Counters.framebufferBinds = state.Issued[GLState::FRAMEBUFFER] - issuedFramebuffers;
+            Counters.textureBinds = state.Issued[GLState::TEXTURE] - issuedTextures;
+            lastCounters = Counters;
+            addFrame(std::chrono::duration<double, std::milli>(now - frameStart).count());
+        }
+        Counters = FrameCounters();
+        capture(state);
+        frameStart = now;
+        frameOpen = true;
+    }
+
+    void countDraw(unsigned long long triangles)
+    {
+        Counters.drawCalls++;
+        Counters.triangles += triangles;
+    }
+    void countUniform(size_t bytes)
+    {
+        Counters.uniformUploads++;
+        Counters.bytesUploaded += bytes;
+    }
+    void countUpload(size_t bytes)
+    {
+        Counters.bytesUploaded += bytes;
+    }
+
+    // counters of the last finished frame
+    const FrameCounters& last() const
+    {
+        return lastCounters;
+    }
+    double lastMilliseconds() const
+    {
+        return frameCount > 0 ? times[(next + HISTORY - 1) % HISTORY] : 0.0;
+    }
+    // frames in the rolling window
+    int frames() const
+    {
+        return (int)std::min(frameCount, (unsigned long long)HISTORY);
+    }
+    // upper edge of the bucket holding the given fraction of the window, e.g. 0.99, at most the maximum
+    double percentile(double fraction) const
+    {
+        int count = frames();
+        if (count == 0)
+            return 0.0;
+        int rank = std::max(1, (int)std::ceil(fraction * count));
+        int seen = 0;
+        for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+        {
+            seen += buckets[bucket];
+            if (seen >= rank)
+                return std::min(maximum(), FIRST_BUCKET_MS * std::pow(BUCKET_GROWTH, bucket));
+        }
+        return maximum();
+    }
+    double maximum() const
+    {
+        int count = frames();
+        double longest = 0.0;
+        for (int i = 0; i < count; i++)
+            longest = std::max(longest, times[i]);
+        return longest;
+    }
+
+    // the percentiles and the last counters, one group per line, e.g. for the overlay
+    // ------------------------------------------------------------------------
+    std::vector<std::string> lines() const
+    {
+        const FrameCounters& counters = lastCounters;
+        std::ostringstream frame, draws, binds, uploads;
+        frame << std::fixed << std::setprecision(2)
+            << "frame ms p50 " << percentile(0.5) << " p95 " << percentile(0.95) << " p99 " << percentile(0.99) << " max " << maximum();
+        draws << "draws " << counters.drawCalls << " tris " << counters.triangles;
+        binds << "binds prog " << counters.programBinds << " fbo " << counters.framebufferBinds << " tex " << counters.textureBinds;
+        uploads << std::fixed << std::setprecision(1)
+            << "uniforms " << counters.uniformUploads << " upload " << counters.bytesUploaded / 1024.0 << " KB";
+        return {frame.str(), draws.str(), binds.str(), uploads.str()};
+    }
+    // the same on one line, for the log
+    std::string summary() const
+    {
+        std::string line;
+        for (const std::string& group : lines())
+            line += (line.empty() ? "" : " | ") + group;
+        return line;
+    }
+
+private:
+    double times[HISTORY];
+    int buckets[BUCKET_COUNT];
+    unsigned long long frameCount;
+    int next;
+    bool frameOpen;
+    std::chrono::steady_clock::time_point frameStart;
+    FrameCounters lastCounters;
+    // GLState counters at the start of the frame
+    unsigned int issuedPrograms;
+    unsigned int issuedFramebuffers;
+    unsigned int issuedTextures;
+    double sinceLog;
+    unsigned long long loggedFrames;
+
+    void capture(const GLState& state)
+    {
+        issuedPrograms = state.Issued[GLState::PROGRAM] + state.Issued[GLState::PIPELINE];
+        issuedFramebuffers = state.Issued[GLState::FRAMEBUFFER];
+        issuedTextures = state.Issued[GLState::TEXTURE];
+    }
+
+    // bucket 0 holds everything below FIRST_BUCKET_MS, bucket i up to FIRST_BUCKET_MS * BUCKET_GROWTH^i
+    static int bucketOf(double milliseconds)
+    {
+        if (milliseconds < FIRST_BUCKET_MS)
+            return 0;
+        int bucket = (int)std::ceil(std::log(milliseconds / FIRST_BUCKET_MS) / std::log(BUCKET_GROWTH));
+        return std::min(BUCKET_COUNT - 1, std::max(0, bucket));
+    }
+
+    void addFrame(double milliseconds)
+    {
+        if (frameCount >= (unsigned long long)HISTORY)
+            buckets[bucketOf(times[next])]--;
+        times[next] = milliseconds;
+        buckets[bucketOf(milliseconds)]++;
+        next = (next + 1) % HISTORY;
+        frameCount++;
+
+        sinceLog += milliseconds / 1000.0;
+        if (LogInterval > 0.0 && sinceLog >= LogInterval)
+        {
+            std::cout << "stats: " << frameCount - loggedFrames << " frames in " << std::fixed << std::setprecision(1) << sinceLog << " s, "
+                << std::defaultfloat << summary() << std::endl;
+            sinceLog = 0.0;
+            loggedFrames = frameCount;
+        }
+    }
+};
+#endif
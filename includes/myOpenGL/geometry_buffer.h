@@ -0,0 +1,263 @@
+#ifndef GEOMETRY_BUFFER_H
+#define GEOMETRY_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+
+#include "gl_state.h"
+#include "frame_stats.h"
+#include "gl_debug.h"
+#include "mesh.h"
+
+// where a mesh lives in a GeometryBuffer, the arguments of an indexed draw
+struct MeshRange
+{
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLint baseVertex;
+    GLuint vertexCount;
+    // dequantization of packed positions, to be applied before the model matrix (identity for float positions)
+    glm::mat4 positionTransform;
+};
+
+// All static meshes in shared vertex and index buffers, so a whole pass can be drawn without rebinding.
+// Positions (location 0) are a tightly packed stream of their own, uv (location 1) and normal (location 2) are
+// interleaved in a second one. VAO reads both streams, PositionVAO only the positions, so depth-only passes
+// fetch 12 instead of 32 bytes per vertex (8 instead of 16 packed). Meshes are added on the CPU and uploaded once, both vertex arrays
+// stay valid for further attributes.
+// Indices are relative to the baseVertex of their mesh, so they are stored in 16 bit unless a mesh is too large.
+// With PackedVertices a vertex takes 16 instead of 32 bytes: positions are UNORM16 within the bounds of their mesh
+// (MeshRange::positionTransform maps them back), uvs are half floats and normals are octahedral SNORM16 pairs that
+// PACKED_VERTICES shaders decode.
+class GeometryBuffer
+{
+public:
+    static const int VERTEX_FLOATS = Mesh::VERTEX_FLOATS;
+
+    unsigned int VAO = 0;
+    unsigned int PositionVAO = 0;
+    // uv and normal stream
+    unsigned int VBO = 0;
+    unsigned int PositionVBO = 0;
+    unsigned int EBO = 0;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, decided by upload()
+    GLenum IndexType = GL_UNSIGNED_INT;
+    // compressed vertex format, has to be set before upload()
+    bool PackedVertices = false;
+    std::vector<MeshRange> Meshes;
+
+    int addMesh(const Mesh& mesh)
+    {
+        return addMesh(mesh.Vertices.data(), mesh.vertexCount(), mesh.Indices.data(), mesh.Indices.size());
+    }
+
+    // adds a mesh and returns its index into Meshes, without indices the vertices are drawn in order
+    // ------------------------------------------------------------------------
+    int addMesh(const float* meshVertices, size_t vertexCount, const unsigned int* meshIndices = nullptr, size_t indexCount = 0)
+    {
+        MeshRange mesh;
+        mesh.firstIndex = (GLuint)indices.size();
+        mesh.baseVertex = (GLint)(vertices.size() / VERTEX_FLOATS);
+        vertices.insert(vertices.end(), meshVertices, meshVertices + vertexCount * VERTEX_FLOATS);
+        if (meshIndices != nullptr)
+            indices.insert(indices.end(), meshIndices, meshIndices + indexCount);
+        else
+        {
+            indexCount = vertexCount;
+            for (size_t i = 0; i < vertexCount; i++)
+                indices.push_back((unsigned int)i);
+        }
+        if (vertexCount > 65536)
+            shortIndices = false;
+        mesh.indexCount = (GLuint)indexCount;
+        mesh.vertexCount = (GLuint)vertexCount;
+        mesh.positionTransform = glm::mat4(1.0f);
+        Meshes.push_back(mesh);
+        return (int)Meshes.size() - 1;
+    }
+
+    // creates the buffers and the vertex arrays, the CPU copy of the meshes is released
+    // ------------------------------------------------------------------------
+    void upload()
+    {
+        if (VAO == 0)
+        {
+            glGenVertexArrays(1, &VAO);
+            glGenVertexArrays(1, &PositionVAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &PositionVBO);
+            glGenBuffers(1, &EBO);
+        }
+        if (PackedVertices)
+            uploadPacked();
+        else
+        {
+            size_t vertexCount = vertices.size() / VERTEX_FLOATS;
+            std::vector<float> positions;
+            std::vector<float> attributes;
+            positions.reserve(vertexCount * 3);
+            attributes.reserve(vertexCount * (VERTEX_FLOATS - 3));
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                const float* vertex = &vertices[i * VERTEX_FLOATS];
+                positions.insert(positions.end(), vertex, vertex + 3);
+                attributes.insert(attributes.end(), vertex + 3, vertex + VERTEX_FLOATS);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, PositionVBO);
+            glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+            FrameStats::current().countUpload(positions.size() * sizeof(float));
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, attributes.size() * sizeof(float), attributes.data(), GL_STATIC_DRAW);
+            FrameStats::current().countUpload(attributes.size() * sizeof(float));
+        }
+
+        // the element buffer binding is vertex array state, it is set up with the position stream of each
+        GLState& state = GLState::current();
+        state.bindVertexArray(PositionVAO);
+        bindPositions();
+        if (shortIndices)
+        {
+            IndexType = GL_UNSIGNED_SHORT;
+            std::vector<unsigned short> packed(indices.begin(), indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size() * sizeof(unsigned short), packed.data(), GL_STATIC_DRAW);
+            FrameStats::current().countUpload(packed.size() * sizeof(unsigned short));
+        }
+        else
+        {
+            IndexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+            FrameStats::current().countUpload(indices.size() * sizeof(unsigned int));
+        }
+        state.bindVertexArray(VAO);
+        bindPositions();
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        if (PackedVertices)
+        {
+            glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, 8, (void*)0);
+            glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, 8, (void*)4);
+        }
+        else
+        {
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(2*sizeof(float)));
+        }
+        vertices = std::vector<float>();
+        indices = std::vector<unsigned int>();
+    }
+
+    // names the vertex arrays and buffers for KHR_debug, after upload()
+    void label(const std::string& name) const
+    {
+        GLDebug& debug = GLDebug::current();
+        debug.label(GL_VERTEX_ARRAY, VAO, name + " vertex array");
+        debug.label(GL_VERTEX_ARRAY, PositionVAO, name + " position vertex array");
+        debug.label(GL_BUFFER, VBO, name + " attributes");
+        debug.label(GL_BUFFER, PositionVBO, name + " positions");
+        debug.label(GL_BUFFER, EBO, name + " indices");
+    }
+
+    // the vertex array of a pass, depth-only passes need nothing but positions
+    unsigned int vertexArray(bool positionOnly) const
+    {
+        return positionOnly ? PositionVAO : VAO;
+    }
+
+    // draws the instances of a mesh, one of the vertex arrays has to be bound
+    // ------------------------------------------------------------------------
+    void draw(int mesh, GLsizei instanceCount = 1) const
+    {
+        const MeshRange& range = Meshes[mesh];
+        const void* offset = (const void*)(size_t)(range.firstIndex * indexSize());
+        if (instanceCount == 1)
+            glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, IndexType, offset, range.baseVertex);
+        else
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, IndexType, offset, instanceCount, range.baseVertex);
+        FrameStats::current().countDraw((unsigned long long)range.indexCount / 3 * instanceCount);
+    }
+    size_t indexSize() const
+    {
+        return IndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    }
+
+private:
+    bool shortIndices = true;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    // the position stream and the element buffer of the bound vertex array
+    void bindPositions()
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, PositionVBO);
+        glEnableVertexAttribArray(0);
+        if (PackedVertices)
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 4*sizeof(uint16_t), (void*)0);
+        else
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    }
+
+    // quantizes the positions of every mesh to its bounds and packs uv and normal into 8 bytes
+    void uploadPacked()
+    {
+        size_t vertexCount = vertices.size() / VERTEX_FLOATS;
+        std::vector<uint64_t> positions(vertexCount);
+        std::vector<uint32_t> attributes(vertexCount * 2);
+        for (MeshRange& mesh : Meshes)
+        {
+            const float* first = &vertices[mesh.baseVertex * VERTEX_FLOATS];
+            glm::vec3 minimum(first[0], first[1], first[2]);
+            glm::vec3 maximum = minimum;
+            for (GLuint i = 0; i < mesh.vertexCount; i++)
+            {
+                glm::vec3 position(first[i * VERTEX_FLOATS], first[i * VERTEX_FLOATS + 1], first[i * VERTEX_FLOATS + 2]);
+                minimum = glm::min(minimum, position);
+                maximum = glm::max(maximum, position);
+            }
+            // a flat axis keeps a scale of 1, all its positions quantize to 0
+            glm::vec3 extent = maximum - minimum;
+            for (int axis = 0; axis < 3; axis++)
+                if (extent[axis] <= 0.0f)
+                    extent[axis] = 1.0f;
+            mesh.positionTransform = glm::scale(glm::translate(glm::mat4(1.0f), minimum), extent);
+
+            for (GLuint i = 0; i < mesh.vertexCount; i++)
+            {
+                const float* vertex = first + i * VERTEX_FLOATS;
+                size_t index = mesh.baseVertex + i;
+                glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+                positions[index] = glm::packUnorm4x16(glm::vec4((position - minimum) / extent, 0.0f));
+                attributes[index * 2] = glm::packHalf2x16(glm::vec2(vertex[3], vertex[4]));
+                attributes[index * 2 + 1] = glm::packSnorm2x16(encodeOctahedral(glm::vec3(vertex[5], vertex[6], vertex[7])));
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, PositionVBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(uint64_t), positions.data(), GL_STATIC_DRAW);
+        FrameStats::current().countUpload(positions.size() * sizeof(uint64_t));
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, attributes.size() * sizeof(uint32_t), attributes.data(), GL_STATIC_DRAW);
+        FrameStats::current().countUpload(attributes.size() * sizeof(uint32_t));
+    }
+
+    // projects the unit normal onto the octahedron and folds the lower half over, see decodeOctahedral in mainShader.vert
+    static glm::vec2 encodeOctahedral(glm::vec3 normal)
+    {
+        normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        glm::vec2 encoded(normal.x, normal.y);
+        if (normal.z < 0.0f)
+        {
+            encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+            encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        return encoded;
+    }
+};
+#endif
@@ -0,0 +1,237 @@
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// a distinct driver message and how often it came, messages with the same source, type, id and pass are one
+struct GLDebugMessage
+{
+    GLenum source;
+    GLenum type;
+    GLuint id;
+    GLenum severity;
+    // debug group the message came in, e.g. the render pass
+    std::string group;
+    std::string text;
+    unsigned long long count;
+};
+
+// KHR_debug for the current context, opt-in: labels objects so debuggers and driver messages name them, wraps the
+// passes in debug groups, and collects the driver's messages. Output is synchronous, so a message arrives inside the
+// call that caused it and is attributed to the open group. The first occurrence of a message is printed, repeats are
+// only counted; notifications are counted but not printed. Performance messages (recompiles, stalls, slow paths)
+// get a count of their own. Needs GL 4.3, everything is a no-op until enable() succeeded.
+class GLDebug
+{
+public:
+    // wraps the enclosing block in a debug group
+    class Group
+    {
+    public:
+        Group(const std::string& name)
+        {
+            GLDebug::current().pushGroup(name);
+        }
+        ~Group()
+        {
+            GLDebug::current().popGroup();
+        }
+    };
+
+    // the debug output of the current context, the renderer uses a single context
+    static GLDebug& current()
+    {
+        static GLDebug debug;
+        return debug;
+    }
+
+    // installs the message callback, the context has to be current; false where KHR_debug is missing
+    // ------------------------------------------------------------------------
+    bool enable()
+    {
+        if (!GLAD_GL_VERSION_4_3)
+        {
+            std::cout << "ERROR::GL_DEBUG::NOT_SUPPORTED: KHR_debug needs OpenGL 4.3" << std::endl;
+            return false;
+        }
+        GLint flags = 0;
+        glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+        if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+            std::cout << "WARNING::GL_DEBUG::NO_DEBUG_CONTEXT: the driver may report fewer messages" << std::endl;
+        glGetIntegerv(GL_MAX_LABEL_LENGTH, &maxLabelLength);
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(callback, this);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+        // our own groups would echo back as messages
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        active = true;
+        return true;
+    }
+    // removes the callback, e.g. before the context goes away
+    void disable()
+    {
+        if (!active)
+            return;
+        glDebugMessageCallback(nullptr, nullptr);
+        glDisable(GL_DEBUG_OUTPUT);
+        active = false;
+        groups.clear();
+    }
+    bool enabled() const
+    {
+        return active;
+    }
+
+    // names an object in driver messages and debuggers, identifier is e.g. GL_TEXTURE, GL_BUFFER or GL_PROGRAM.
+    // A buffer, vertex array or pipeline has to have been bound once, a name from glGen* alone is no object yet
+    void label(GLenum identifier, GLuint name, const std::string& text)
+    {
+        if (!active || name == 0)
+            return;
+        std::string clipped = text.substr(0, std::max(0, maxLabelLength - 1));
+        glObjectLabel(identifier, name, (GLsizei)clipped.size(), clipped.c_str());
+    }
+
+    void pushGroup(const std::string& name)
+    {
+        if (!active)
+            return;
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str());
+        std::lock_guard<std::mutex> lock(mutex);
+        groups.push_back(name);
+    }
+    void popGroup()
+    {
+        if (!active)
+            return;
+        glPopDebugGroup();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!groups.empty())
+            groups.pop_back();
+    }
+
+    // distinct messages so far, the most frequent first
+    std::vector<GLDebugMessage> messages() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<GLDebugMessage> sorted;
+        for (const auto& message : log)
+            sorted.push_back(message.second);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const GLDebugMessage& a, const GLDebugMessage& b) { return a.count > b.count; });
+        return sorted;
+    }
+    // messages of one type, repeats included, e.g. GL_DEBUG_TYPE_PERFORMANCE
+    unsigned long long count(GLenum type) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = typeCounts.find(type);
+        return it == typeCounts.end() ? 0 : it->second;
+    }
+
+    // message counts per type and the distinct messages
+    // ------------------------------------------------------------------------
+    void print(std::ostream& out = std::cout) const
+    {
+        std::vector<GLDebugMessage> sorted = messages();
+        out << "GL debug messages:";
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (typeCounts.empty())
+                out << " none";
+            for (const auto& type : typeCounts)
+                out << " " << typeName(type.first) << " " << type.second;
+        }
+        out << std::endl;
+        for (const GLDebugMessage& message : sorted)
+            out << "  " << message.count << "x " << describe(message) << std::endl;
+    }
+
+private:
+    bool active = false;
+    GLint maxLabelLength = 256;
+    mutable std::mutex mutex;
+    std::vector<std::string> groups;
+    std::map<std::tuple<GLenum, GLenum, GLuint, std::string>, GLDebugMessage> log;
+    std::map<GLenum, unsigned long long> typeCounts;
+
+    static void APIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user)
+    {
+        ((GLDebug*)user)->receive(source, type, id, severity, length < 0 ? std::string(message) : std::string(message, length));
+    }
+
+    void receive(GLenum source, GLenum type, GLuint id, GLenum severity, const std::string& text)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        typeCounts[type]++;
+        std::string group = groups.empty() ? std::string() : groups.back();
+        auto key = std::make_tuple(source, type, id, group);
+        auto it = log.find(key);
+        if (it != log.end())
+        {
+            it->second.count++;
+            return;
+        }
+        GLDebugMessage& entry = log[key];
+        entry = GLDebugMessage{source, type, id, severity, group, text, 1};
+        if (severity != GL_DEBUG_SEVERITY_NOTIFICATION)
+            std::cout << "GL_DEBUG::" << describe(entry) << std::endl;
+    }
+
+    // TYPE::SEVERITY source id [group]: text
+    static std::string describe(const GLDebugMessage& message)
+    {
+        std::string line = typeName(message.type) + "::" + severityName(message.severity) + " " + sourceName(message.source) + " " + std::to_string(message.id);
+        if (!message.group.empty())
+            line += " [" + message.group + "]";
+        std::string text = message.text;
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            text.pop_back();
+        return line + ": " + text;
+    }
+    static std::string typeName(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_DEBUG_TYPE_ERROR: return "ERROR";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "UNDEFINED";
+        case GL_DEBUG_TYPE_PORTABILITY: return "PORTABILITY";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "PERFORMANCE";
+        case GL_DEBUG_TYPE_MARKER: return "MARKER";
+        default: return "OTHER";
+        }
+    }
+    static std::string severityName(GLenum severity)
+    {
+        switch (severity)
+        {
+        case GL_DEBUG_SEVERITY_HIGH: return "HIGH";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "MEDIUM";
+        case GL_DEBUG_SEVERITY_LOW: return "LOW";
+        default: return "NOTIFICATION";
+        }
+    }
+    static std::string sourceName(GLenum source)
+    {
+        switch (source)
+        {
+        case GL_DEBUG_SOURCE_API: return "api";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "application";
+        default: return "other";
+        }
+    }
+};
+#endif
@@ -0,0 +1,269 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <unordered_map>
+#include <iostream>
+
+// Shadow copy of the GL state the renderer changes: program, pipeline, framebuffers, vertex array, texture units,
+// viewport, clear color and enable bits. Calls that would not change the state are dropped and counted.
+// Everything that changes this state has to go through GLState, otherwise invalidate() must be called afterwards.
+// Deleting a bound texture, framebuffer or vertex array unbinds it in GL, so deletions need invalidate() too.
+class GLState
+{
+public:
+    enum Call
+    {
+        PROGRAM,
+        PIPELINE,
+        FRAMEBUFFER,
+        VERTEX_ARRAY,
+        TEXTURE,
+        VIEWPORT,
+        CLEAR_COLOR,
+        CAPABILITY,
+        CALL_COUNT
+    };
+    // calls passed on to GL and calls dropped as redundant, per kind of state
+    unsigned int Issued[CALL_COUNT];
+    unsigned int Elided[CALL_COUNT];
+
+    static const int MAX_TEXTURE_UNITS = 32;
+    // a shadowed binding that is not known since the last invalidate()
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    // the tracker of the current context, the renderer uses a single context
+    static GLState& current()
+    {
+        static GLState state;
+        return state;
+    }
+
+    GLState()
+    {
+        invalidate();
+        resetCounters();
+    }
+
+    // forgets the shadowed state, the next call of every kind reaches GL
+    // ------------------------------------------------------------------------
+    void invalidate()
+    {
+        program = UNKNOWN;
+        pipeline = UNKNOWN;
+        drawFramebuffer = UNKNOWN;
+        readFramebuffer = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            for (int target = 0; target < TARGET_COUNT; target++)
+                textures[unit][target] = UNKNOWN;
+        viewportValid = false;
+        clearColorValid = false;
+        capabilities.clear();
+    }
+    void resetCounters()
+    {
+        for (int i = 0; i < CALL_COUNT; i++)
+            Issued[i] = Elided[i] = 0;
+    }
+    unsigned int issuedTotal() const
+    {
+        unsigned int total = 0;
+        for (int i = 0; i < CALL_COUNT; i++)
+            total += Issued[i];
+        return total;
+    }
+    unsigned int elidedTotal() const
+    {
+        unsigned int total = 0;
+        for (int i = 0; i < CALL_COUNT; i++)
+            total += Elided[i];
+        return total;
+    }
+
+    // ------------------------------------------------------------------------
+    void useProgram(GLuint id)
+    {
+        if (!changed(PROGRAM, program, id))
+            return;
+        glUseProgram(id);
+    }
+    void bindProgramPipeline(GLuint id)
+    {
+        if (!changed(PIPELINE, pipeline, id))
+            return;
+        glBindProgramPipeline(id);
+    }
+    // the shadowed bindings, UNKNOWN until set through GLState
+    GLuint boundProgram() const
+    {
+        return program;
+    }
+    GLuint boundPipeline() const
+    {
+        return pipeline;
+    }
+    // GL_FRAMEBUFFER binds the draw and the read framebuffer
+    void bindFramebuffer(GLenum target, GLuint id)
+    {
+        bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+        bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+        if ((!draw || drawFramebuffer == id) && (!read || readFramebuffer == id))
+        {
+            Elided[FRAMEBUFFER]++;
+            return;
+        }
+        Issued[FRAMEBUFFER]++;
+        if (draw)
+            drawFramebuffer = id;
+        if (read)
+            readFramebuffer = id;
+        glBindFramebuffer(target, id);
+    }
+    void bindVertexArray(GLuint id)
+    {
+        if (!changed(VERTEX_ARRAY, vertexArray, id))
+            return;
+        glBindVertexArray(id);
+    }
+    // binds the texture to the unit and leaves the unit active, so glTexParameter and friends can follow
+    void bindTexture(GLuint unit, GLenum target, GLuint id)
+    {
+        activeTexture(unit);
+        int index = targetIndex(target);
+        if (unit < MAX_TEXTURE_UNITS && index >= 0)
+        {
+            if (textures[unit][index] == id)
+            {
+                Elided[TEXTURE]++;
+                return;
+            }
+            textures[unit][index] = id;
+        }
+        Issued[TEXTURE]++;
+        glBindTexture(target, id);
+    }
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (viewportValid && viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height)
+        {
+            Elided[VIEWPORT]++;
+            return;
+        }
+        viewportValid = true;
+        viewportRect[0] = x;
+        viewportRect[1] = y;
+        viewportRect[2] = width;
+        viewportRect[3] = height;
+        Issued[VIEWPORT]++;
+        glViewport(x, y, width, height);
+    }
+    void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        if (clearColorValid && color[0] == red && color[1] == green && color[2] == blue && color[3] == alpha)
+        {
+            Elided[CLEAR_COLOR]++;
+            return;
+        }
+        clearColorValid = true;
+        color[0] = red;
+        color[1] = green;
+        color[2] = blue;
+        color[3] = alpha;
+        Issued[CLEAR_COLOR]++;
+        glClearColor(red, green, blue, alpha);
+    }
+    void enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+    void disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+
+    // prints issued and elided calls per kind of state
+    void print(std::ostream& out = std::cout) const
+    {
+        const char* names[CALL_COUNT] = {"program", "pipeline", "framebuffer", "vertex array", "texture", "viewport", "clear color", "capability"};
+        out << "GL state calls (issued/elided):";
+        for (int i = 0; i < CALL_COUNT; i++)
+            out << " " << names[i] << " " << Issued[i] << "/" << Elided[i];
+        out << std::endl;
+    }
+
+private:
+    enum TextureTarget
+    {
+        TARGET_2D,
+        TARGET_2D_ARRAY,
+        TARGET_CUBE_MAP,
+        TARGET_3D,
+        TARGET_COUNT
+    };
+
+    GLuint program;
+    GLuint pipeline;
+    GLuint drawFramebuffer;
+    GLuint readFramebuffer;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint textures[MAX_TEXTURE_UNITS][TARGET_COUNT];
+    bool viewportValid;
+    GLint viewportRect[4];
+    bool clearColorValid;
+    GLfloat color[4];
+    std::unordered_map<GLenum, bool> capabilities;
+
+    bool changed(Call call, GLuint& shadow, GLuint value)
+    {
+        if (shadow == value)
+        {
+            Elided[call]++;
+            return false;
+        }
+        shadow = value;
+        Issued[call]++;
+        return true;
+    }
+
+    // not counted on its own, it is part of a texture binding
+    void activeTexture(GLuint unit)
+    {
+        if (activeUnit == unit)
+            return;
+        activeUnit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    void setCapability(GLenum capability, bool enabled)
+    {
+        auto it = capabilities.find(capability);
+        if (it != capabilities.end() && it->second == enabled)
+        {
+            Elided[CAPABILITY]++;
+            return;
+        }
+        capabilities[capability] = enabled;
+        Issued[CAPABILITY]++;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    static int targetIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D: return TARGET_2D;
+        case GL_TEXTURE_2D_ARRAY: return TARGET_2D_ARRAY;
+        case GL_TEXTURE_CUBE_MAP: return TARGET_CUBE_MAP;
+        case GL_TEXTURE_3D: return TARGET_3D;
+        default: return -1;
+        }
+    }
+};
+#endif
@@ -0,0 +1,298 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "cpu_trace.h"
+
+// GPU time of one scope of a frame
+struct GpuTiming
+{
+    std::string name;
+    double milliseconds;
+};
+
+// Timestamp queries around named scopes of the frame loop. The queries of a frame are read FRAME_LATENCY frames
+// later, when the GPU has long finished them, so profiling never waits for the GPU; a frame whose results are
+// still not there is dropped. Scopes may nest, each one is timed on its own.
+// Results come as the latest resolved frame, as rolling statistics per scope, as a table and as CSV rows. While the
+// CPU trace records, the scopes also go to its GPU track, moved onto the steady clock by the offset between the GL
+// timestamp and the steady clock at the start of their frame.
+class GpuProfiler
+{
+public:
+    // frames between issuing the queries of a frame and reading them back
+    static const int FRAME_LATENCY = 4;
+    // frames the rolling statistics cover
+    static const int HISTORY = 120;
+
+    // rolling statistics of a scope over the last HISTORY resolved frames
+    struct ScopeStats
+    {
+        std::string name;
+        double last;
+        double average;
+        double maximum;
+    };
+
+    // frames read back, and frames whose queries were not ready in time and were dropped instead of waited for
+    unsigned long long Dropped = 0;
+    unsigned long long Resolved = 0;
+
+    // times the enclosing block
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler& profiler, const std::string& name) : profiler(profiler)
+        {
+            profiler.begin(name);
+        }
+        ~Scope()
+        {
+            profiler.end();
+        }
+
+    private:
+        GpuProfiler& profiler;
+    };
+
+    // starts a new frame and closes the previous one, reads back the frame that used this slot before
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (frameOpen)
+            endFrame();
+        current = (int)(frameCounter % FRAME_LATENCY);
+        FrameSlot& slot = slots[current];
+        if (slot.pending)
+        {
+            if (available(slot))
+                resolve(slot);
+            else
+                Dropped++;
+        }
+        slot.pending = false;
+        slot.frame = frameCounter++;
+        slot.scopes.clear();
+        slot.usedQueries = 0;
+        slot.traced = CpuTrace::global().enabled();
+        if (slot.traced)
+        {
+            // the current GL time is returned without waiting for the commands before it
+            GLint64 gpuNow = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+            slot.clockOffset = (int64_t)CpuTrace::now() - gpuNow;
+        }
+        open.clear();
+        frameOpen = true;
+    }
+    // scopes still open are closed with the frame
+    void endFrame()
+    {
+        if (!frameOpen)
+            return;
+        while (!open.empty())
+            end();
+        slots[current].pending = !slots[current].scopes.empty();
+        frameOpen = false;
+    }
+
+    // scopes outside of a frame are ignored
+    void begin(const std::string& name)
+    {
+        if (!frameOpen)
+            return;
+        FrameSlot& slot = slots[current];
+        GLuint query = timestamp(slot);
+        slot.scopes.push_back(PendingScope{name, query, 0});
+        open.push_back(slot.scopes.size() - 1);
+    }
+    void end()
+    {
+        if (!frameOpen || open.empty())
+            return;
+        FrameSlot& slot = slots[current];
+        GLuint query = timestamp(slot);
+        slot.scopes[open.back()].endQuery = query;
+        open.pop_back();
+    }
+
+    // waits for every frame still in flight and reads it back, e.g. before printing the results at exit
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        endFrame();
+        std::vector<FrameSlot*> pending;
+        for (FrameSlot& slot : slots)
+            if (slot.pending)
+                pending.push_back(&slot);
+        std::sort(pending.begin(), pending.end(), [](const FrameSlot* a, const FrameSlot* b) { return a->frame < b->frame; });
+        for (FrameSlot* slot : pending)
+        {
+            resolve(*slot);
+            slot->pending = false;
+        }
+    }
+
+    // deletes the queries, the context has to be current still
+    void release()
+    {
+        for (FrameSlot& slot : slots)
+        {
+            if (!slot.queries.empty())
+                glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+            slot.queries.clear();
+            slot.pending = false;
+        }
+        frameOpen = false;
+    }
+
+    // scopes of the most recent frame that was read back, and its number
+    const std::vector<GpuTiming>& latest() const
+    {
+        return latestTimings;
+    }
+    unsigned long long latestFrame() const
+    {
+        return latestFrameNumber;
+    }
+    // rolling statistics of every scope, in the order the scopes first appeared
+    std::vector<ScopeStats> stats() const
+    {
+        std::vector<ScopeStats> result;
+        for (const std::string& name : scopeNames)
+        {
+            const std::deque<double>& samples = history.at(name);
+            ScopeStats scope = {name, samples.back(), 0.0, 0.0};
+            for (double sample : samples)
+            {
+                scope.average += sample;
+                scope.maximum = std::max(scope.maximum, sample);
+            }
+            scope.average /= samples.size();
+            result.push_back(scope);
+        }
+        return result;
+    }
+
+    // table of the rolling statistics
+    // ------------------------------------------------------------------------
+    void print(std::ostream& out = std::cout) const
+    {
+        out << "gpu time (ms, last " << (int)HISTORY << " frames)    last   average   maximum" << std::endl;
+        std::ios::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        for (const ScopeStats& scope : stats())
+            out << "  " << std::left << std::setw(28) << scope.name << std::right << std::setw(9) << scope.last
+                << std::setw(10) << scope.average << std::setw(10) << scope.maximum << std::endl;
+        out.flags(flags);
+        out << "  " << Resolved << " frames resolved, " << Dropped << " dropped" << std::endl;
+    }
+
+    // appends a frame,scope,gpu_ms row for every scope of every frame read back from now on
+    bool writeCsv(const std::string& path)
+    {
+        csv.open(path);
+        if (!csv)
+        {
+            std::cout << "ERROR::GPU_PROFILER::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        csv << "frame,scope,gpu_ms" << std::endl;
+        return true;
+    }
+
+private:
+    struct PendingScope
+    {
+        std::string name;
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+    // the queries of one frame in flight, the slots are used round robin
+    struct FrameSlot
+    {
+        std::vector<GLuint> queries;
+        size_t usedQueries = 0;
+        std::vector<PendingScope> scopes;
+        unsigned long long frame = 0;
+        bool pending = false;
+        // steady clock minus GL time, for the CPU trace
+        bool traced = false;
+        int64_t clockOffset = 0;
+    };
+
+    FrameSlot slots[FRAME_LATENCY];
+    int current = 0;
+    unsigned long long frameCounter = 0;
+    bool frameOpen = false;
+    // scopes of the current frame that have not ended
+    std::vector<size_t> open;
+
+    std::vector<GpuTiming> latestTimings;
+    unsigned long long latestFrameNumber = 0;
+    std::vector<std::string> scopeNames;
+    std::map<std::string, std::deque<double>> history;
+    std::ofstream csv;
+
+    GLuint timestamp(FrameSlot& slot)
+    {
+        if (slot.usedQueries == slot.queries.size())
+        {
+            GLuint query;
+            glGenQueries(1, &query);
+            slot.queries.push_back(query);
+        }
+        GLuint query = slot.queries[slot.usedQueries++];
+        glQueryCounter(query, GL_TIMESTAMP);
+        return query;
+    }
+
+    static bool available(const FrameSlot& slot)
+    {
+        for (size_t i = 0; i < slot.usedQueries; i++)
+        {
+            GLuint ready = GL_FALSE;
+            glGetQueryObjectuiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready)
+                return false;
+        }
+        return true;
+    }
+
+    void resolve(const FrameSlot& slot)
+    {
+        latestTimings.clear();
+        for (const PendingScope& scope : slot.scopes)
+        {
+            GLuint64 beginTime = 0, endTime = 0;
+            glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &beginTime);
+            glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &endTime);
+            double milliseconds = (endTime - beginTime) / 1.0e6;
+            latestTimings.push_back(GpuTiming{scope.name, milliseconds});
+
+            std::deque<double>& samples = history[scope.name];
+            if (samples.empty())
+                scopeNames.push_back(scope.name);
+            samples.push_back(milliseconds);
+            if (samples.size() > (size_t)HISTORY)
+                samples.pop_front();
+            if (slot.traced)
+                CpuTrace::global().recordGpu(CpuTrace::global().intern(scope.name), beginTime + slot.clockOffset, endTime + slot.clockOffset);
+            if (csv.is_open())
+                csv << slot.frame << "," << scope.name << "," << milliseconds << "\n";
+        }
+        latestFrameNumber = slot.frame;
+        Resolved++;
+    }
+};
+#endif
@@ -0,0 +1,156 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 8 bit RGB pixels, top row first
+struct RgbImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    // from glReadPixels rows, which start at the bottom
+    static RgbImage fromBottomUp(int width, int height, const std::vector<unsigned char>& rows)
+    {
+        RgbImage image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize((size_t)width * height * 3);
+        for (int row = 0; row < height; row++)
+            std::copy_n(&rows[(size_t)(height - 1 - row) * width * 3], (size_t)width * 3, &image.pixels[(size_t)row * width * 3]);
+        return image;
+    }
+
+    // binary PPM
+    bool save(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::IMAGE::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        file.write((const char*)pixels.data(), (std::streamsize)pixels.size());
+        return (bool)file;
+    }
+    bool load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::string magic;
+        int maximum = 0;
+        if (!(file >> magic >> width >> height >> maximum) || magic != "P6" || maximum != 255 || width <= 0 || height <= 0)
+        {
+            std::cout << "ERROR::IMAGE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+        file.get();
+        pixels.resize((size_t)width * height * 3);
+        if (!file.read((char*)pixels.data(), (std::streamsize)pixels.size()))
+        {
+            std::cout << "ERROR::IMAGE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+// Structural similarity of the luma of two images of the same size, 1 for identical images. Local means, variances
+// and the covariance come from an 11x11 Gaussian window (sigma 1.5) as in Wang et al. 2004; the window is cut at
+// the borders. map receives the SSIM of every pixel, e.g. for a heatmap. -1 if the sizes differ.
+// ------------------------------------------------------------------------
+inline double structuralSimilarity(const RgbImage& a, const RgbImage& b, std::vector<float>* map = nullptr)
+{
+    if (a.width != b.width || a.height != b.height || a.pixels.size() != b.pixels.size())
+        return -1.0;
+    const int width = a.width;
+    const int height = a.height;
+    const size_t count = (size_t)width * height;
+    const int radius = 5;
+    float kernel[2 * radius + 1];
+    for (int i = -radius; i <= radius; i++)
+        kernel[i + radius] = std::exp(-(i * i) / (2.0f * 1.5f * 1.5f));
+
+    // x, y, x², y², xy, blurred separably
+    std::vector<float> channels[5];
+    for (std::vector<float>& channel : channels)
+        channel.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const unsigned char* p = &a.pixels[i * 3];
+        const unsigned char* q = &b.pixels[i * 3];
+        float x = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+        float y = 0.299f * q[0] + 0.587f * q[1] + 0.114f * q[2];
+        channels[0][i] = x;
+        channels[1][i] = y;
+        channels[2][i] = x * x;
+        channels[3][i] = y * y;
+        channels[4][i] = x * y;
+    }
+    std::vector<float> rows(count);
+    for (std::vector<float>& channel : channels)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            const std::vector<float>& source = pass == 0 ? channel : rows;
+            std::vector<float>& target = pass == 0 ? rows : channel;
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++)
+                {
+                    float sum = 0.0f, weight = 0.0f;
+                    for (int i = -radius; i <= radius; i++)
+                    {
+                        int sx = pass == 0 ? x + i : x;
+                        int sy = pass == 0 ? y : y + i;
+                        if (sx < 0 || sx >= width || sy < 0 || sy >= height)
+                            continue;
+                        sum += kernel[i + radius] * source[(size_t)sy * width + sx];
+                        weight += kernel[i + radius];
+                    }
+                    target[(size_t)y * width + x] = sum / weight;
+                }
+        }
+    }
+
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    if (map != nullptr)
+        map->resize(count);
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double mx = channels[0][i], my = channels[1][i];
+        double vx = std::max(0.0, channels[2][i] - mx * mx);
+        double vy = std::max(0.0, channels[3][i] - my * my);
+        double cxy = channels[4][i] - mx * my;
+        double ssim = ((2.0 * mx * my + c1) * (2.0 * cxy + c2)) / ((mx * mx + my * my + c1) * (vx + vy + c2));
+        if (map != nullptr)
+            (*map)[i] = (float)ssim;
+        total += ssim;
+    }
+    return total / count;
+}
+
+// dissimilarity of an SSIM map as black (equal) through red to yellow (1 - SSIM of 0.5 and more)
+inline RgbImage similarityHeatmap(const std::vector<float>& map, int width, int height)
+{
+    RgbImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 3);
+    for (size_t i = 0; i < map.size(); i++)
+    {
+        float error = std::min(1.0f, std::max(0.0f, (1.0f - map[i]) * 2.0f));
+        image.pixels[i * 3 + 0] = (unsigned char)(255.0f * std::min(1.0f, error * 2.0f));
+        image.pixels[i * 3 + 1] = (unsigned char)(255.0f * std::max(0.0f, error * 2.0f - 1.0f));
+        image.pixels[i * 3 + 2] = 0;
+    }
+    return image;
+}
+#endif
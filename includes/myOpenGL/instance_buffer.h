@@ -0,0 +1,122 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "gl_state.h"
+#include "frame_stats.h"
+#include "gl_debug.h"
+
+// per-instance vertex data, the normal matrix is computed on the CPU once instead of per vertex
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+};
+
+// The instances of one mesh. The matrices are kept on the CPU as well, so a renderer without instancing can walk
+// the same list. Instanced shaders (INSTANCED define) read the model matrix from attribute locations 3-6 and the
+// normal matrix from locations 7-9, attach() points these attributes of a vertex array at the buffer.
+// A mesh with several vertex arrays, e.g. GeometryBuffer's position-only one, needs the attributes in each.
+class InstanceBuffer
+{
+public:
+    static const GLuint MODEL_LOCATION = 3;
+    static const GLuint NORMAL_MATRIX_LOCATION = 7;
+
+    unsigned int VBO = 0;
+    std::vector<InstanceData> Instances;
+
+    // applied to every model matrix on the GPU only, e.g. the dequantization of packed mesh positions
+    void setPositionTransform(const glm::mat4& transform)
+    {
+        positionTransform = transform;
+        dirty = true;
+    }
+
+    void clear()
+    {
+        Instances.clear();
+        dirty = true;
+    }
+    void add(const glm::mat4& model)
+    {
+        InstanceData instance;
+        instance.model = model;
+        instance.normalMatrix = normalMatrix(model);
+        Instances.push_back(instance);
+        dirty = true;
+    }
+    GLsizei size() const
+    {
+        return (GLsizei)Instances.size();
+    }
+
+    // transpose(inverse(mat3(model))), the same as the 4x4 inverse for affine transforms but without it:
+    // the inverse transpose of a 3x3 matrix is its cofactor matrix, three cross products, over the determinant
+    // ------------------------------------------------------------------------
+    static glm::mat3 normalMatrix(const glm::mat4& model)
+    {
+        glm::mat3 linear(model);
+        glm::mat3 cofactors(glm::cross(linear[1], linear[2]), glm::cross(linear[2], linear[0]), glm::cross(linear[0], linear[1]));
+        float determinant = glm::dot(linear[0], cofactors[0]);
+        return cofactors * (1.0f / determinant);
+    }
+
+    // copies the instances to the GPU if they changed since the last upload
+    // ------------------------------------------------------------------------
+    void upload()
+    {
+        if (VBO == 0)
+            glGenBuffers(1, &VBO);
+        if (!dirty)
+            return;
+        dirty = false;
+        std::vector<InstanceData> transformed(Instances);
+        for (InstanceData& instance : transformed)
+            instance.model = instance.model * positionTransform;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // new storage, a draw still reading the old one does not stall the update
+        glBufferData(GL_ARRAY_BUFFER, transformed.size() * sizeof(InstanceData), transformed.data(), GL_STATIC_DRAW);
+        FrameStats::current().countUpload(transformed.size() * sizeof(InstanceData));
+    }
+
+    // names the buffer for KHR_debug, once it was uploaded
+    void label(const std::string& name) const
+    {
+        GLDebug::current().label(GL_BUFFER, VBO, name);
+    }
+
+    // sets up the instance attributes of the vertex array, uploads the instances first if needed
+    // ------------------------------------------------------------------------
+    void attach(unsigned int vertexArray)
+    {
+        upload();
+        GLState::current().bindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(MODEL_LOCATION + column);
+            glVertexAttribPointer(MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(MODEL_LOCATION + column, 1);
+        }
+        for (GLuint column = 0; column < 3; column++)
+        {
+            glEnableVertexAttribArray(NORMAL_MATRIX_LOCATION + column);
+            glVertexAttribPointer(NORMAL_MATRIX_LOCATION + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                (void*)(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+            glVertexAttribDivisor(NORMAL_MATRIX_LOCATION + column, 1);
+        }
+    }
+
+private:
+    bool dirty = true;
+    glm::mat4 positionTransform = glm::mat4(1.0f);
+};
+#endif
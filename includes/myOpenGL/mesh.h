@@ -0,0 +1,228 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <unordered_map>
+
+// An indexed triangle mesh on the CPU, vertices are interleaved position, uv and normal (8 floats).
+// Meshes are optimized once when they are imported: optimizeVertexCache() orders the triangles so the
+// post-transform vertex cache is reused, optimizeVertexFetch() then orders the vertices by first use so the
+// vertex fetch walks memory linearly. Nothing here needs a GL context.
+class Mesh
+{
+public:
+    static const int VERTEX_FLOATS = 8;
+
+    std::vector<float> Vertices;
+    std::vector<unsigned int> Indices;
+
+    // welds the identical vertices of a non-indexed triangle list
+    // ------------------------------------------------------------------------
+    static Mesh fromTriangles(const float* vertices, size_t vertexCount)
+    {
+        Mesh mesh;
+        std::unordered_map<std::string, unsigned int> unique;
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const float* vertex = vertices + i * VERTEX_FLOATS;
+            std::string key((const char*)vertex, VERTEX_FLOATS * sizeof(float));
+            auto it = unique.find(key);
+            if (it == unique.end())
+            {
+                it = unique.emplace(key, (unsigned int)mesh.vertexCount()).first;
+                mesh.Vertices.insert(mesh.Vertices.end(), vertex, vertex + VERTEX_FLOATS);
+            }
+            mesh.Indices.push_back(it->second);
+        }
+        return mesh;
+    }
+
+    size_t vertexCount() const
+    {
+        return Vertices.size() / VERTEX_FLOATS;
+    }
+    size_t triangleCount() const
+    {
+        return Indices.size() / 3;
+    }
+    // whether the indices fit into 16 bit
+    bool fitsShortIndices() const
+    {
+        return vertexCount() <= 65536;
+    }
+
+    // both optimizations, the order matters: fetch order follows the triangle order
+    void optimize()
+    {
+        optimizeVertexCache();
+        optimizeVertexFetch();
+    }
+
+    // reorders the triangles for a post-transform cache of the given size, Tom Forsyth's linear-speed algorithm:
+    // every step emits the triangle with the best score, vertices score high when they are in the cache
+    // and when few triangles still need them
+    // ------------------------------------------------------------------------
+    void optimizeVertexCache(int cacheSize = 32)
+    {
+        size_t vertices = vertexCount();
+        size_t triangles = triangleCount();
+        if (triangles == 0)
+            return;
+
+        std::vector<std::vector<unsigned int>> vertexTriangles(vertices);
+        for (size_t t = 0; t < triangles; t++)
+            for (int corner = 0; corner < 3; corner++)
+                vertexTriangles[Indices[t * 3 + corner]].push_back((unsigned int)t);
+        std::vector<int> cachePosition(vertices, -1);
+        std::vector<float> vertexScore(vertices);
+        for (size_t v = 0; v < vertices; v++)
+            vertexScore[v] = score(-1, (int)vertexTriangles[v].size(), cacheSize);
+        std::vector<bool> emitted(triangles, false);
+        std::vector<float> triangleScore(triangles);
+        for (size_t t = 0; t < triangles; t++)
+            triangleScore[t] = vertexScore[Indices[t * 3]] + vertexScore[Indices[t * 3 + 1]] + vertexScore[Indices[t * 3 + 2]];
+
+        std::vector<unsigned int> optimized;
+        optimized.reserve(Indices.size());
+        std::vector<unsigned int> cache;
+        size_t nextUnemitted = 0;
+        long best = bestTriangle(triangleScore, emitted, nextUnemitted);
+        while (best >= 0)
+        {
+            emitted[best] = true;
+            std::vector<unsigned int> updatedCache;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int v = Indices[best * 3 + corner];
+                optimized.push_back(v);
+                updatedCache.push_back(v);
+                std::vector<unsigned int>& adjacent = vertexTriangles[v];
+                for (size_t i = 0; i < adjacent.size(); i++)
+                    if (adjacent[i] == (unsigned int)best)
+                    {
+                        adjacent[i] = adjacent.back();
+                        adjacent.pop_back();
+                        break;
+                    }
+            }
+            for (unsigned int v : cache)
+                if (v != updatedCache[0] && v != updatedCache[1] && v != updatedCache[2])
+                    updatedCache.push_back(v);
+            // vertices pushed out of the cache lose their cache bonus
+            for (size_t i = cacheSize; i < updatedCache.size(); i++)
+            {
+                cachePosition[updatedCache[i]] = -1;
+                vertexScore[updatedCache[i]] = score(-1, (int)vertexTriangles[updatedCache[i]].size(), cacheSize);
+            }
+            if (updatedCache.size() > (size_t)cacheSize)
+            {
+                for (size_t i = cacheSize; i < updatedCache.size(); i++)
+                    updateTriangleScores(updatedCache[i], vertexTriangles, vertexScore, triangleScore);
+                updatedCache.resize(cacheSize);
+            }
+            cache.swap(updatedCache);
+
+            // the next triangle is taken from the ones touching the cache, all others did not change
+            best = -1;
+            float bestScore = -1.0f;
+            for (size_t i = 0; i < cache.size(); i++)
+            {
+                unsigned int v = cache[i];
+                cachePosition[v] = (int)i;
+                vertexScore[v] = score((int)i, (int)vertexTriangles[v].size(), cacheSize);
+            }
+            for (unsigned int v : cache)
+            {
+                for (unsigned int t : vertexTriangles[v])
+                {
+                    triangleScore[t] = vertexScore[Indices[t * 3]] + vertexScore[Indices[t * 3 + 1]] + vertexScore[Indices[t * 3 + 2]];
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+            if (best < 0)
+                best = bestTriangle(triangleScore, emitted, nextUnemitted);
+        }
+        Indices.swap(optimized);
+    }
+
+    // renumbers the vertices in the order the indices first use them, unused vertices are dropped
+    // ------------------------------------------------------------------------
+    void optimizeVertexFetch()
+    {
+        const unsigned int unused = 0xFFFFFFFFu;
+        std::vector<unsigned int> remap(vertexCount(), unused);
+        std::vector<float> reordered;
+        reordered.reserve(Vertices.size());
+        unsigned int next = 0;
+        for (unsigned int& index : Indices)
+        {
+            if (remap[index] == unused)
+            {
+                remap[index] = next++;
+                reordered.insert(reordered.end(), Vertices.begin() + index * VERTEX_FLOATS, Vertices.begin() + (index + 1) * VERTEX_FLOATS);
+            }
+            index = remap[index];
+        }
+        Vertices.swap(reordered);
+    }
+
+    // average cache miss ratio, transformed vertices per triangle for a FIFO cache of the given size (0.5 - 3)
+    // ------------------------------------------------------------------------
+    float cacheMissRatio(int cacheSize = 16) const
+    {
+        if (triangleCount() == 0)
+            return 0.0f;
+        std::vector<int> insertedAt(vertexCount(), -1);
+        int misses = 0;
+        for (unsigned int index : Indices)
+        {
+            if (insertedAt[index] < 0 || misses - insertedAt[index] >= cacheSize)
+            {
+                insertedAt[index] = misses;
+                misses++;
+            }
+        }
+        return (float)misses / (float)triangleCount();
+    }
+
+private:
+    static float score(int cachePosition, int remainingTriangles, int cacheSize)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+        float result = 0.0f;
+        // the last triangle's vertices get a fixed score, so the strip-like order is not preferred too much
+        if (cachePosition >= 0 && cachePosition < 3)
+            result = 0.75f;
+        else if (cachePosition >= 3)
+            result = std::pow(1.0f - (float)(cachePosition - 3) / (float)(cacheSize - 3), 1.5f);
+        // vertices with few triangles left are finished first
+        return result + 2.0f / std::sqrt((float)remainingTriangles);
+    }
+
+    void updateTriangleScores(unsigned int vertex, const std::vector<std::vector<unsigned int>>& vertexTriangles,
+        const std::vector<float>& vertexScore, std::vector<float>& triangleScore) const
+    {
+        for (unsigned int t : vertexTriangles[vertex])
+            triangleScore[t] = vertexScore[Indices[t * 3]] + vertexScore[Indices[t * 3 + 1]] + vertexScore[Indices[t * 3 + 2]];
+    }
+
+    // best remaining triangle when the cache offers none, this only happens at the start of a disconnected part
+    static long bestTriangle(const std::vector<float>& triangleScore, const std::vector<bool>& emitted, size_t& nextUnemitted)
+    {
+        while (nextUnemitted < emitted.size() && emitted[nextUnemitted])
+            nextUnemitted++;
+        long best = -1;
+        for (size_t t = nextUnemitted; t < emitted.size(); t++)
+            if (!emitted[t] && (best < 0 || triangleScore[t] > triangleScore[best]))
+                best = (long)t;
+        return best;
+    }
+};
+#endif
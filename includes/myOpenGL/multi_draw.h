@@ -0,0 +1,142 @@
+#ifndef MULTI_DRAW_H
+#define MULTI_DRAW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+
+#include "gl_state.h"
+#include "frame_stats.h"
+#include "geometry_buffer.h"
+#include "instance_buffer.h"
+#include "gl_debug.h"
+
+// layout of glMultiDrawElementsIndirect commands
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// per-object data read by MULTI_DRAW shaders from the storage buffer, std430 layout (see drawData.glsl)
+struct DrawData
+{
+    glm::mat4 model;
+    // columns of the normal matrix, a std430 mat3 pads every column to a vec4
+    glm::vec4 normalMatrix[3];
+    // x: specular exponent
+    glm::vec4 material;
+};
+
+// The draws of a pass over one GeometryBuffer, submitted with a single glMultiDrawElementsIndirect.
+// Every object gets a DrawData entry, a command covers the instances of one mesh and its baseInstance is the
+// index of its first entry. Shaders find their entry through the aDrawIndex attribute (location 10), an instanced
+// attribute over 0, 1, 2, ... that the baseInstance offsets, so neither gl_DrawID nor gl_BaseInstance is needed.
+// Needs GL 4.3 for indirect multi-draw and storage buffers, see supported().
+class MultiDrawBatch
+{
+public:
+    static const GLuint DRAW_DATA_BINDING = 0;
+    static const GLuint DRAW_INDEX_LOCATION = 10;
+
+    std::vector<DrawElementsIndirectCommand> Commands;
+    std::vector<DrawData> Draws;
+
+    static bool supported()
+    {
+        return GLAD_GL_VERSION_4_3;
+    }
+
+    void clear()
+    {
+        Commands.clear();
+        Draws.clear();
+    }
+    // one command drawing every instance of the mesh
+    // ------------------------------------------------------------------------
+    void add(const MeshRange& mesh, const InstanceBuffer& instances, const glm::vec4& material)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = mesh.indexCount;
+        command.instanceCount = (GLuint)instances.Instances.size();
+        command.firstIndex = mesh.firstIndex;
+        command.baseVertex = mesh.baseVertex;
+        command.baseInstance = (GLuint)Draws.size();
+        Commands.push_back(command);
+        for (const InstanceData& instance : instances.Instances)
+        {
+            DrawData draw;
+            draw.model = instance.model * mesh.positionTransform;
+            for (int column = 0; column < 3; column++)
+                draw.normalMatrix[column] = glm::vec4(instance.normalMatrix[column], 0.0f);
+            draw.material = material;
+            Draws.push_back(draw);
+        }
+    }
+
+    // uploads commands and draw data, and adds the draw index attribute to both vertex arrays of the geometry
+    // ------------------------------------------------------------------------
+    void upload(const GeometryBuffer& geometry)
+    {
+        if (commandBuffer == 0)
+        {
+            glGenBuffers(1, &commandBuffer);
+            glGenBuffers(1, &drawDataBuffer);
+            glGenBuffers(1, &drawIndexBuffer);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, Commands.size() * sizeof(DrawElementsIndirectCommand), Commands.data(), GL_STATIC_DRAW);
+        FrameStats::current().countUpload(Commands.size() * sizeof(DrawElementsIndirectCommand));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, Draws.size() * sizeof(DrawData), Draws.data(), GL_STATIC_DRAW);
+        FrameStats::current().countUpload(Draws.size() * sizeof(DrawData));
+
+        std::vector<GLuint> drawIndices(Draws.size());
+        for (size_t i = 0; i < drawIndices.size(); i++)
+            drawIndices[i] = (GLuint)i;
+        glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIndices.size() * sizeof(GLuint), drawIndices.data(), GL_STATIC_DRAW);
+        FrameStats::current().countUpload(drawIndices.size() * sizeof(GLuint));
+        for (unsigned int vertexArray : {geometry.VAO, geometry.PositionVAO})
+        {
+            GLState::current().bindVertexArray(vertexArray);
+            glEnableVertexAttribArray(DRAW_INDEX_LOCATION);
+            glVertexAttribIPointer(DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+            glVertexAttribDivisor(DRAW_INDEX_LOCATION, 1);
+        }
+    }
+
+    // names the buffers for KHR_debug, after upload()
+    void label(const std::string& name) const
+    {
+        GLDebug& debug = GLDebug::current();
+        debug.label(GL_BUFFER, commandBuffer, name + " commands");
+        debug.label(GL_BUFFER, drawDataBuffer, name + " draw data");
+        debug.label(GL_BUFFER, drawIndexBuffer, name + " draw indices");
+    }
+
+    // draws every command, the shader has to be in use
+    // ------------------------------------------------------------------------
+    void draw(const GeometryBuffer& geometry, bool positionOnly = false)
+    {
+        GLState::current().bindVertexArray(geometry.vertexArray(positionOnly));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, geometry.IndexType, nullptr, (GLsizei)Commands.size(), 0);
+        unsigned long long triangles = 0;
+        for (const DrawElementsIndirectCommand& command : Commands)
+            triangles += (unsigned long long)command.count / 3 * command.instanceCount;
+        FrameStats::current().countDraw(triangles);
+    }
+
+private:
+    unsigned int commandBuffer = 0;
+    unsigned int drawDataBuffer = 0;
+    unsigned int drawIndexBuffer = 0;
+};
+#endif
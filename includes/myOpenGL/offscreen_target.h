@@ -0,0 +1,53 @@
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "gl_state.h"
+
+// RGBA8 color and 24 bit depth in a framebuffer object, stands in for the window when rendering headless
+class OffscreenTarget
+{
+public:
+    unsigned int Framebuffer = 0;
+    unsigned int ColorBuffer = 0;
+    unsigned int DepthBuffer = 0;
+    int Width = 0;
+    int Height = 0;
+
+    bool create(int width, int height)
+    {
+        Width = width;
+        Height = height;
+        glGenFramebuffers(1, &Framebuffer);
+        glGenRenderbuffers(1, &ColorBuffer);
+        glGenRenderbuffers(1, &DepthBuffer);
+        GLState::current().bindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, ColorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, DepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::OFFSCREEN_TARGET::INCOMPLETE_FRAMEBUFFER" << std::endl;
+            destroy();
+            return false;
+        }
+        return true;
+    }
+
+    void destroy()
+    {
+        glDeleteFramebuffers(1, &Framebuffer);
+        glDeleteRenderbuffers(1, &ColorBuffer);
+        glDeleteRenderbuffers(1, &DepthBuffer);
+        Framebuffer = ColorBuffer = DepthBuffer = 0;
+        // the framebuffer may still be bound
+        GLState::current().invalidate();
+    }
+};
+#endif
@@ -0,0 +1,413 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <functional>
+#include <iostream>
+
+#include "gl_state.h"
+#include "gl_debug.h"
+
+// size and format of a transient texture, textures with equal descriptions can share memory
+struct RenderTextureDesc
+{
+    int width;
+    int height;
+    // a float, normalized or depth format, integer formats are not supported
+    GLenum internalFormat;
+
+    bool operator==(const RenderTextureDesc& other) const
+    {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat;
+    }
+};
+
+// Passes declare the textures they read and write, the graph wires framebuffers and texture units for them.
+// compile() culls every pass that does not contribute to the output, orders the rest by their dependencies and
+// gives each transient texture a texture of the pool. Transient textures whose lifetimes do not overlap share one
+// pool texture, so a chain of blurs needs two textures however long it is.
+// Sampling state lives in sampler objects chosen per read, a pool texture keeps no state of the resource it backs.
+// The graph is built once, compile() only has to be called again when passes or resources change.
+class RenderGraph
+{
+public:
+    typedef int Resource;
+    typedef int Pass;
+
+    // called with the pass name right before and after each scheduled pass executes, e.g. for timings
+    std::function<void(const std::string&)> BeginPass;
+    std::function<void(const std::string&)> EndPass;
+
+    // a texture owned by the graph, valid between the first write and the last read of a frame
+    Resource createTexture(const std::string& name, const RenderTextureDesc& desc)
+    {
+        resources.push_back(ResourceEntry{name, desc, false, -1});
+        compiled = false;
+        return (Resource)resources.size() - 1;
+    }
+    // a framebuffer owned by someone else, e.g. 0 for the window. Each pass drawing to it needs its own handle,
+    // so only the one that is the output is kept
+    Resource importFramebuffer(const std::string& name, unsigned int framebuffer, int width, int height)
+    {
+        resources.push_back(ResourceEntry{name, RenderTextureDesc{width, height, GL_NONE}, true, -1});
+        resources.back().framebuffer = framebuffer;
+        compiled = false;
+        return (Resource)resources.size() - 1;
+    }
+    // the resource the frame is for, only the passes it depends on are executed
+    void setOutput(Resource resource)
+    {
+        output = resource;
+        compiled = false;
+    }
+
+    Pass addPass(const std::string& name, std::function<void()> execute)
+    {
+        passes.push_back(PassEntry(name, execute));
+        compiled = false;
+        return (Pass)passes.size() - 1;
+    }
+    // binds the texture to the unit while the pass executes, CLAMP_TO_BORDER reads (1, 1, 1, 1) outside
+    void read(Pass pass, Resource resource, GLuint unit, GLenum wrap = GL_CLAMP_TO_EDGE)
+    {
+        passes[pass].reads.push_back(Read{resource, unit, wrap});
+        compiled = false;
+    }
+    // attaches the texture to the framebuffer of the pass, a depth format as the depth attachment
+    void write(Pass pass, Resource resource)
+    {
+        if (resources[resource].writer >= 0)
+            std::cout << "ERROR::RENDER_GRAPH::MULTIPLE_WRITERS " << resources[resource].name << std::endl;
+        resources[resource].writer = pass;
+        passes[pass].writes.push_back(resource);
+        compiled = false;
+    }
+
+    // culls, schedules and assigns pool textures, creates the framebuffers of the scheduled passes
+    // ------------------------------------------------------------------------
+    bool compile()
+    {
+        compiled = false;
+        schedule.clear();
+        if (output < 0)
+        {
+            std::cout << "ERROR::RENDER_GRAPH::NO_OUTPUT" << std::endl;
+            return false;
+        }
+
+        // a pass is needed when it writes the output or a resource a needed pass reads
+        std::vector<bool> needed(passes.size(), false);
+        std::vector<Resource> pending = {output};
+        while (!pending.empty())
+        {
+            Resource resource = pending.back();
+            pending.pop_back();
+            Pass writer = resources[resource].writer;
+            if (writer < 0 || needed[writer])
+                continue;
+            needed[writer] = true;
+            for (const Read& input : passes[writer].reads)
+                pending.push_back(input.resource);
+        }
+
+        // repeatedly take the first needed pass whose inputs are all written, declaration order breaks ties
+        std::vector<bool> scheduled(passes.size(), false);
+        size_t neededCount = 0;
+        for (bool pass : needed)
+            neededCount += pass ? 1 : 0;
+        while (schedule.size() < neededCount)
+        {
+            Pass next = -1;
+            for (Pass pass = 0; pass < (Pass)passes.size() && next < 0; pass++)
+            {
+                if (!needed[pass] || scheduled[pass])
+                    continue;
+                bool ready = true;
+                for (const Read& input : passes[pass].reads)
+                {
+                    Pass writer = resources[input.resource].writer;
+                    if (writer < 0)
+                    {
+                        std::cout << "ERROR::RENDER_GRAPH::UNWRITTEN_INPUT " << resources[input.resource].name << std::endl;
+                        return false;
+                    }
+                    ready = ready && scheduled[writer];
+                }
+                if (ready)
+                    next = pass;
+            }
+            if (next < 0)
+            {
+                std::cout << "ERROR::RENDER_GRAPH::CYCLE" << std::endl;
+                return false;
+            }
+            scheduled[next] = true;
+            schedule.push_back(next);
+        }
+
+        allocate();
+        for (Pass pass : schedule)
+            passes[pass].framebuffer = framebuffer(pass);
+        label();
+        compiled = true;
+        return true;
+    }
+
+    // runs the scheduled passes, compiling first if the graph changed
+    // ------------------------------------------------------------------------
+    void execute()
+    {
+        if (!compiled && !compile())
+            return;
+        GLState& state = GLState::current();
+        for (Pass pass : schedule)
+        {
+            const PassEntry& entry = passes[pass];
+            state.bindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+            if (!entry.writes.empty())
+            {
+                const RenderTextureDesc& target = resources[entry.writes[0]].desc;
+                state.viewport(0, 0, target.width, target.height);
+            }
+            for (const Read& input : entry.reads)
+            {
+                state.bindTexture(input.unit, GL_TEXTURE_2D, texture(input.resource));
+                glBindSampler(input.unit, sampler(input.wrap));
+            }
+            GLDebug::current().pushGroup(entry.name);
+            if (BeginPass)
+                BeginPass(entry.name);
+            entry.execute();
+            if (EndPass)
+                EndPass(entry.name);
+            GLDebug::current().popGroup();
+            // code outside the graph does not expect sampler objects
+            for (const Read& input : entry.reads)
+                glBindSampler(input.unit, 0);
+        }
+    }
+
+    // the pool texture backing a resource, 0 for an imported framebuffer or a culled resource
+    unsigned int texture(Resource resource) const
+    {
+        int slot = resources[resource].slot;
+        return slot < 0 ? 0 : pool[slot].texture;
+    }
+
+    // passes and transient textures of the schedule against pool textures and their memory
+    // ------------------------------------------------------------------------
+    void print(std::ostream& out = std::cout) const
+    {
+        size_t transient = 0;
+        size_t transientBytes = 0;
+        for (const ResourceEntry& resource : resources)
+            if (resource.slot >= 0)
+            {
+                transient++;
+                transientBytes += textureBytes(resource.desc);
+            }
+        size_t poolBytes = 0;
+        for (const PoolTexture& texture : pool)
+            poolBytes += textureBytes(texture.desc);
+        out << "render graph:";
+        for (Pass pass : schedule)
+            out << " " << passes[pass].name;
+        out << " (" << schedule.size() << "/" << passes.size() << " passes), " << transient << " transient textures in "
+            << pool.size() << " pool textures, " << poolBytes / 1024 << " of " << transientBytes / 1024 << " KiB" << std::endl;
+    }
+
+private:
+    struct ResourceEntry
+    {
+        std::string name;
+        RenderTextureDesc desc;
+        bool imported;
+        Pass writer;
+        // pool texture, -1 for imported or culled resources
+        int slot = -1;
+        // the imported framebuffer
+        unsigned int framebuffer = 0;
+    };
+    struct Read
+    {
+        Resource resource;
+        GLuint unit;
+        GLenum wrap;
+    };
+    struct PassEntry
+    {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<Read> reads;
+        std::vector<Resource> writes;
+        unsigned int framebuffer = 0;
+
+        PassEntry(const std::string& name, std::function<void()> execute) : name(name), execute(execute)
+        {
+        }
+    };
+    struct PoolTexture
+    {
+        RenderTextureDesc desc;
+        unsigned int texture;
+        // schedule position of the last read of the resource it currently backs
+        int busyUntil;
+    };
+
+    std::vector<ResourceEntry> resources;
+    std::vector<PassEntry> passes;
+    std::vector<Pass> schedule;
+    Resource output = -1;
+    bool compiled = false;
+    std::vector<PoolTexture> pool;
+    std::map<std::vector<unsigned int>, unsigned int> framebuffers;
+    std::map<GLenum, unsigned int> samplers;
+
+    static bool isDepthFormat(GLenum format)
+    {
+        return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F;
+    }
+    static size_t textureBytes(const RenderTextureDesc& desc)
+    {
+        size_t texelBytes = 4;
+        if (desc.internalFormat == GL_RG32F || desc.internalFormat == GL_RGBA16F)
+            texelBytes = 8;
+        else if (desc.internalFormat == GL_RGBA32F)
+            texelBytes = 16;
+        return (size_t)desc.width * desc.height * texelBytes;
+    }
+
+    // walks the schedule once, a resource takes a free pool texture of its description at its write and frees it
+    // after its last read; pool textures are kept over compiles, only missing ones are created
+    void allocate()
+    {
+        std::vector<int> lastUse(resources.size(), -1);
+        for (int position = 0; position < (int)schedule.size(); position++)
+        {
+            for (const Read& input : passes[schedule[position]].reads)
+                lastUse[input.resource] = position;
+            for (Resource resource : passes[schedule[position]].writes)
+                if (lastUse[resource] < position)
+                    lastUse[resource] = position;
+        }
+        for (ResourceEntry& resource : resources)
+            resource.slot = -1;
+        for (PoolTexture& texture : pool)
+            texture.busyUntil = -1;
+
+        for (int position = 0; position < (int)schedule.size(); position++)
+        {
+            for (Resource resource : passes[schedule[position]].writes)
+            {
+                ResourceEntry& entry = resources[resource];
+                if (entry.imported)
+                    continue;
+                int slot = -1;
+                for (int i = 0; i < (int)pool.size() && slot < 0; i++)
+                    if (pool[i].desc == entry.desc && pool[i].busyUntil < position)
+                        slot = i;
+                if (slot < 0)
+                {
+                    pool.push_back(PoolTexture{entry.desc, createTexture(entry.desc), -1});
+                    slot = (int)pool.size() - 1;
+                }
+                pool[slot].busyUntil = lastUse[resource];
+                entry.slot = slot;
+            }
+        }
+    }
+
+    unsigned int createTexture(const RenderTextureDesc& desc)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        GLState::current().bindTexture(0, GL_TEXTURE_2D, texture);
+        bool depth = isDepthFormat(desc.internalFormat);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, depth ? GL_DEPTH_COMPONENT : GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        return texture;
+    }
+
+    // one framebuffer per set of attachments, passes writing the same pool textures share it,
+    // a pass writing an imported framebuffer draws to that one
+    unsigned int framebuffer(Pass pass)
+    {
+        std::vector<unsigned int> attachments;
+        for (Resource resource : passes[pass].writes)
+        {
+            if (resources[resource].imported)
+                return resources[resource].framebuffer;
+            attachments.push_back(texture(resource));
+        }
+        if (attachments.empty())
+            return 0;
+        auto it = framebuffers.find(attachments);
+        if (it != framebuffers.end())
+            return it->second;
+
+        unsigned int framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        GLState::current().bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        GLenum colorAttachment = GL_COLOR_ATTACHMENT0;
+        for (Resource resource : passes[pass].writes)
+        {
+            GLenum attachment = isDepthFormat(resources[resource].desc.internalFormat) ? GL_DEPTH_ATTACHMENT : colorAttachment++;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture(resource), 0);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::RENDER_GRAPH::INCOMPLETE_FRAMEBUFFER " << passes[pass].name << std::endl;
+        framebuffers.emplace(attachments, framebuffer);
+        return framebuffer;
+    }
+
+    // names the pool textures after the resources they back and the framebuffers after the passes drawing to them,
+    // for KHR_debug messages and frame debuggers
+    void label()
+    {
+        GLDebug& debug = GLDebug::current();
+        if (!debug.enabled())
+            return;
+        std::vector<std::string> textureNames(pool.size());
+        for (const ResourceEntry& resource : resources)
+            if (resource.slot >= 0)
+                textureNames[resource.slot] += (textureNames[resource.slot].empty() ? "" : " / ") + resource.name;
+        for (size_t i = 0; i < pool.size(); i++)
+            debug.label(GL_TEXTURE, pool[i].texture, textureNames[i].empty() ? "unused pool texture" : textureNames[i]);
+        std::map<unsigned int, std::string> framebufferNames;
+        for (const auto& owned : framebuffers)
+            framebufferNames[owned.second];
+        for (Pass pass : schedule)
+        {
+            auto it = framebufferNames.find(passes[pass].framebuffer);
+            if (it != framebufferNames.end())
+                it->second += (it->second.empty() ? "" : " / ") + passes[pass].name + " framebuffer";
+        }
+        for (const auto& framebuffer : framebufferNames)
+            debug.label(GL_FRAMEBUFFER, framebuffer.first, framebuffer.second.empty() ? "unused framebuffer" : framebuffer.second);
+    }
+
+    // linear filtering, the wrap mode on both axes
+    unsigned int sampler(GLenum wrap)
+    {
+        auto it = samplers.find(wrap);
+        if (it != samplers.end())
+            return it->second;
+        unsigned int sampler;
+        glGenSamplers(1, &sampler);
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrap);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrap);
+        GLfloat borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+        GLDebug::current().label(GL_SAMPLER, sampler, wrap == GL_CLAMP_TO_BORDER ? "border sampler" : wrap == GL_CLAMP_TO_EDGE ? "edge sampler" : "sampler");
+        samplers.emplace(wrap, sampler);
+        return sampler;
+    }
+};
+#endif
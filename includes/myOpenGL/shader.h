@@ -8,163 +8,362 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
 
-class Shader
+#include "shader_preprocessor.h"
+#include "shader_reflection.h"
+#include "gl_state.h"
+#include "frame_stats.h"
+
+// KHR_parallel_shader_compile is not part of the generated glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// preprocessed sources of one program, a stage with empty code is left out.
+// A separable program holds a single stage and is combined with others in a program pipeline
+struct ShaderSources
 {
-public:
-    unsigned int ID;
-    // constructor generates the shader on the fly
-    // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+    bool separable = false;
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string geometryCode;
+    // files that were read per stage, used to decode compiler messages and to watch for changes
+    std::vector<std::string> vertexFiles;
+    std::vector<std::string> fragmentFiles;
+    std::vector<std::string> geometryFiles;
+
+    // preprocesses all given stages, returns false if a file could not be read
+    bool load(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const ShaderDefines& defines = ShaderDefines())
+    {
+        ShaderPreprocessor preprocessor;
+        bool success = true;
+        if(vertexPath != nullptr)
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            success = preprocessor.process(vertexPath, defines, vertexCode);
+            vertexFiles = preprocessor.Files;
         }
-        catch (std::ifstream::failure& e)
+        if(fragmentPath != nullptr)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            success = preprocessor.process(fragmentPath, defines, fragmentCode) && success;
+            fragmentFiles = preprocessor.Files;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
         if(geometryPath != nullptr)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            success = preprocessor.process(geometryPath, defines, geometryCode) && success;
+            geometryFiles = preprocessor.Files;
+        }
+        return success;
+    }
+    // wraps code that needs no #include resolution, e.g. EMBEDDED_SHADERS entries, and injects the defines
+    static ShaderSources fromCode(const char* vertexCode, const char* fragmentCode, const char* geometryCode = nullptr, const ShaderDefines& defines = ShaderDefines())
+    {
+        ShaderSources sources;
+        sources.vertexCode = ShaderPreprocessor::injectDefines(vertexCode, defines);
+        sources.fragmentCode = ShaderPreprocessor::injectDefines(fragmentCode, defines);
+        if(geometryCode != nullptr)
+            sources.geometryCode = ShaderPreprocessor::injectDefines(geometryCode, defines);
+        return sources;
+    }
+    // every file any stage depends on, without duplicates
+    std::vector<std::string> dependencies() const
+    {
+        std::vector<std::string> files = vertexFiles;
+        for(const std::vector<std::string>* stageFiles : {&fragmentFiles, &geometryFiles})
+            for(const std::string& file : *stageFiles)
+                if(std::find(files.begin(), files.end(), file) == files.end())
+                    files.push_back(file);
+        return files;
+    }
+};
+
+// a program whose compile and link have been issued but not checked yet, so drivers can build it in the background
+struct ShaderBuild
+{
+    unsigned int program = 0;
+    unsigned int vertex = 0;
+    unsigned int fragment = 0;
+    unsigned int geometry = 0;
+    ShaderSources sources;
+};
+
+// A program, or a program pipeline of separable stage programs (see ShaderCache) when Pipeline is not 0.
+// The interface is the same for both, so pipelines can be used wherever a program is.
+class Shader
+{
+public:
+    unsigned int ID;
+    // program pipeline object and its stage programs, the stages are owned by the ShaderCache
+    unsigned int Pipeline = 0;
+    std::vector<unsigned int> Stages;
+    // every file the program was built from, including the resolved #include files
+    std::vector<std::string> Dependencies;
+    // interface of the linked program or of all pipeline stages, Generation changes whenever it is rebuilt
+    ShaderReflection Reflection;
+    unsigned int Generation = 0;
+    // empty shader, ShaderCache fills in pipelines
+    // ------------------------------------------------------------------------
+    Shader() : ID(0)
+    {
+    }
+    // constructor generates the shader on the fly, the defines are injected into every stage
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const ShaderDefines& defines = ShaderDefines())
+    {
+        // 1. retrieve the vertex/fragment source code from filePath, resolving #include directives
+        ShaderSources sources;
+        sources.load(vertexPath, fragmentPath, geometryPath, defines);
+        Dependencies = sources.dependencies();
+        // 2. compile shaders and link the program
+        ShaderBuild build = beginBuild(sources);
+        // a failed program is kept so the uniform setters stay harmless
+        finishBuild(build, false);
+        ID = build.program;
+        reflect();
+    }
+    // constructor for sources that are already in memory, e.g. the shaders embedded at build time
+    // ------------------------------------------------------------------------
+    Shader(const ShaderSources& sources)
+    {
+        Dependencies = sources.dependencies();
+        ShaderBuild build = beginBuild(sources);
+        finishBuild(build, false);
+        ID = build.program;
+        reflect();
+    }
+    // reads the active uniforms, blocks and attributes again, after linking or replacing a program or stage
+    // ------------------------------------------------------------------------
+    void reflect()
+    {
+        Reflection.clear();
+        if(Pipeline != 0)
+        {
+            for(unsigned int stage : Stages)
+                Reflection.reflect(stage);
         }
+        else
+            Reflection.reflect(ID);
+        Generation++;
+    }
+    // whether the program uses the uniform, setting an unused uniform does nothing
+    // ------------------------------------------------------------------------
+    bool hasUniform(const std::string &name) const
+    {
+        return Reflection.findUniform(name) != nullptr;
+    }
+    // true if the program or pipeline is the one uniforms are currently written to, as far as GLState knows;
+    // a binding GLState has not seen since its last invalidate() counts as current, GL is never queried
+    // ------------------------------------------------------------------------
+    bool isCurrent() const
+    {
+        const GLState& state = GLState::current();
+        GLuint program = state.boundProgram();
+        GLuint pipeline = state.boundPipeline();
+        if(Pipeline == 0)
+            return program == ID || program == GLState::UNKNOWN;
+        return (program == 0 || program == GLState::UNKNOWN) && (pipeline == Pipeline || pipeline == GLState::UNKNOWN);
+    }
+    // issues the compilation and linking of the sources without querying the result
+    // ------------------------------------------------------------------------
+    static ShaderBuild beginBuild(const ShaderSources& sources)
+    {
+        ShaderBuild build;
+        build.sources = sources;
+        if(!build.sources.vertexCode.empty())
+            build.vertex = compileStage(GL_VERTEX_SHADER, build.sources.vertexCode);
+        if(!build.sources.fragmentCode.empty())
+            build.fragment = compileStage(GL_FRAGMENT_SHADER, build.sources.fragmentCode);
+        // if geometry shader is given, compile geometry shader
+        if(!build.sources.geometryCode.empty())
+            build.geometry = compileStage(GL_GEOMETRY_SHADER, build.sources.geometryCode);
         // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        build.program = glCreateProgram();
+        if(build.sources.separable)
+            glProgramParameteri(build.program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        for(unsigned int stage : {build.vertex, build.fragment, build.geometry})
+            if(stage != 0)
+                glAttachShader(build.program, stage);
+        glLinkProgram(build.program);
+        return build;
+    }
+    // true once the result of the build can be queried without stalling
+    // ------------------------------------------------------------------------
+    static bool buildCompleted(const ShaderBuild& build)
+    {
+        if(!parallelCompileSupported())
+            return true;
+        GLint completed;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+    // checks the build for errors and releases the stage objects. On failure the program
+    // is deleted when deleteOnFailure is set, returns whether the program is usable
+    // ------------------------------------------------------------------------
+    static bool finishBuild(ShaderBuild& build, bool deleteOnFailure = true)
+    {
+        bool success = true;
+        if(build.vertex != 0)
+            success = checkCompileErrors(build.vertex, "VERTEX", build.sources.vertexFiles);
+        if(build.fragment != 0)
+            success = checkCompileErrors(build.fragment, "FRAGMENT", build.sources.fragmentFiles) && success;
+        if(build.geometry != 0)
+            success = checkCompileErrors(build.geometry, "GEOMETRY", build.sources.geometryFiles) && success;
+        success = checkCompileErrors(build.program, "PROGRAM") && success;
         // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        for(unsigned int stage : {build.vertex, build.fragment, build.geometry})
+            if(stage != 0)
+                glDeleteShader(stage);
+        build.vertex = build.fragment = build.geometry = 0;
+        if(!success && deleteOnFailure)
+        {
+            glDeleteProgram(build.program);
+            build.program = 0;
+        }
+        return success;
+    }
+    // whether the driver exposes KHR/ARB_parallel_shader_compile, the context has to be current
+    // ------------------------------------------------------------------------
+    static bool parallelCompileSupported()
+    {
+        static int supported = -1;
+        if(supported < 0)
+        {
+            supported = 0;
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for(GLint i = 0; i < count; i++)
+            {
+                std::string extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+                if(extension == "GL_KHR_parallel_shader_compile" || extension == "GL_ARB_parallel_shader_compile")
+                    supported = 1;
+            }
+        }
+        return supported == 1;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState& state = GLState::current();
+        if(Pipeline != 0)
+        {
+            // a program made current with glUseProgram takes precedence over the bound pipeline
+            state.useProgram(0);
+            state.bindProgramPipeline(Pipeline);
+        }
+        else
+            state.useProgram(ID); 
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        setUniform(name, sizeof(int), [&](GLint location) { glUniform1i(location, (int)value); });
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        setUniform(name, sizeof(int), [&](GLint location) { glUniform1i(location, value); });
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        setUniform(name, sizeof(float), [&](GLint location) { glUniform1f(location, value); });
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setUniform(name, sizeof(glm::vec2), [&](GLint location) { glUniform2fv(location, 1, &value[0]); });
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        setUniform(name, sizeof(glm::vec2), [&](GLint location) { glUniform2f(location, x, y); });
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setUniform(name, sizeof(glm::vec3), [&](GLint location) { glUniform3fv(location, 1, &value[0]); });
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        setUniform(name, sizeof(glm::vec3), [&](GLint location) { glUniform3f(location, x, y, z); });
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setUniform(name, sizeof(glm::vec4), [&](GLint location) { glUniform4fv(location, 1, &value[0]); });
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        setUniform(name, sizeof(glm::vec4), [&](GLint location) { glUniform4f(location, x, y, z, w); });
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(name, sizeof(glm::mat2), [&](GLint location) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); });
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(name, sizeof(glm::mat3), [&](GLint location) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); });
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(name, sizeof(glm::mat4), [&](GLint location) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); });
+    }
+    // points the uniform block at a buffer binding point, in every stage of a pipeline that declares it
+    // ------------------------------------------------------------------------
+    void setUniformBlockBinding(const std::string &name, GLuint binding) const
+    {
+        for(const UniformBlockInfo& block : Reflection.UniformBlocks)
+            if(block.name == name)
+                glUniformBlockBinding(block.program, block.index, binding);
     }
 
 private:
+    // names that were already reported by the debug checks of setUniform
+    mutable std::unordered_set<std::string> reportedUniforms;
+
+    // calls set with the reflected location of the uniform in the current program. For a pipeline every stage
+    // declaring the uniform is made the active program in turn, so the pipeline has to be bound like a program would
+    template <typename Setter>
+    void setUniform(const std::string &name, size_t size, Setter set) const
+    {
+        const std::vector<size_t>* uniforms = Reflection.findUniform(name);
+#ifndef NDEBUG
+        // these writes would silently do nothing or land in another program
+        if(uniforms == nullptr && reportedUniforms.insert(name).second)
+            std::cout << "WARNING::SHADER::UNIFORM_NOT_ACTIVE: " << name << " (program " << ID << ", pipeline " << Pipeline << ")" << std::endl;
+        if(uniforms != nullptr && !isCurrent() && reportedUniforms.insert(name).second)
+            std::cout << "WARNING::SHADER::UNIFORM_SET_ON_INACTIVE_PROGRAM: " << name << " (program " << ID << ", pipeline " << Pipeline << ")" << std::endl;
+#endif
+        if(uniforms == nullptr)
+            return;
+        for(size_t index : *uniforms)
+        {
+            const UniformInfo& uniform = Reflection.Uniforms[index];
+            if(uniform.location == -1)
+                continue;
+            if(Pipeline != 0)
+                glActiveShaderProgram(Pipeline, uniform.program);
+            set(uniform.location);
+            FrameStats::current().countUniform(size);
+        }
+    }
+    static unsigned int compileStage(GLenum type, const std::string& code)
+    {
+        const char* shaderCode = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &shaderCode, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type, const std::vector<std::string>& files = std::vector<std::string>())
     {
         GLint success;
         GLchar infoLog[1024];
@@ -174,7 +373,11 @@ private:
             if(!success)
             {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog;
+                // source string numbers in the log refer to the preprocessed files
+                for(size_t i = 0; i < files.size(); i++)
+                    std::cout << "source " << i << ": " << files[i] << "\n";
+                std::cout << " -- --------------------------------------------------- -- " << std::endl;
             }
         }
         else
@@ -186,6 +389,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success == GL_TRUE;
     }
 };
 #endif
\ No newline at end of file
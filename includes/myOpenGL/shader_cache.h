@@ -0,0 +1,213 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "shader.h"
+#include "gl_debug.h"
+
+// the sources and defines a cached program was built from, a separable stage program only has its own path set
+struct ShaderPermutation
+{
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath;
+    ShaderDefines defines;
+    bool separable = false;
+
+    // preprocesses the sources of this permutation
+    bool load(ShaderSources& sources) const
+    {
+        sources.separable = separable;
+        return sources.load(vertexPath.empty() ? nullptr : vertexPath.c_str(), fragmentPath.empty() ? nullptr : fragmentPath.c_str(),
+            geometryPath.empty() ? nullptr : geometryPath.c_str(), defines);
+    }
+
+    // the sources and defines for debug labels, e.g. "mainShader.vert + mainShader.frag (SHADOW_VSM)"
+    std::string label() const
+    {
+        std::string text;
+        for (const std::string* path : {&vertexPath, &fragmentPath, &geometryPath})
+            if (!path->empty())
+                text += (text.empty() ? "" : " + ") + *path;
+        std::string names;
+        for (const auto& define : defines)
+            if (define.first != "SEPARABLE_PROGRAM")
+                names += (names.empty() ? "" : " ") + define.first;
+        return names.empty() ? text : text + " (" + names + ")";
+    }
+};
+
+// Owns every shader permutation of the application. A permutation is a (sources, defines) combination,
+// it is compiled the first time it is requested and returned from the cache afterwards.
+// When the context supports separate shader objects (GL 4.1), a permutation is a program pipeline made of
+// separable stage programs instead. Stages are shared between pipelines: a stage is keyed only by the defines its
+// source mentions, so e.g. screenQuad.vert is compiled once for every fragment shader it is combined with.
+// References returned by get() stay valid until clear() is called.
+class ShaderCache
+{
+public:
+    enum EntryType
+    {
+        PROGRAM,
+        STAGE,
+        PIPELINE
+    };
+    struct Entry
+    {
+        EntryType type;
+        ShaderPermutation permutation;
+        Shader shader;
+    };
+
+    // build program pipelines where the context supports them, can be switched off before the first get()
+    bool UseSeparablePrograms = true;
+
+    // returns the program built from the given sources with the defines injected, compiling it on demand
+    // ------------------------------------------------------------------------
+    Shader& get(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines())
+    {
+        return get(vertexPath, fragmentPath, nullptr, defines);
+    }
+    Shader& get(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines& defines)
+    {
+        std::string key = std::string(vertexPath) + "|" + fragmentPath + "|" + (geometryPath ? geometryPath : "") + "|" + ShaderPreprocessor::definesKey(defines);
+        auto it = entries.find(key);
+        if (it != entries.end())
+            return it->second.shader;
+
+        ShaderPermutation permutation;
+        permutation.vertexPath = vertexPath;
+        permutation.fragmentPath = fragmentPath;
+        permutation.geometryPath = geometryPath ? geometryPath : "";
+        permutation.defines = defines;
+        if (!separableProgramsSupported())
+        {
+            Shader& program = entries.emplace(key, Entry{PROGRAM, permutation, Shader(vertexPath, fragmentPath, geometryPath, defines)}).first->second.shader;
+            GLDebug::current().label(GL_PROGRAM, program.ID, permutation.label());
+            return program;
+        }
+
+        // only the pipeline object is new, the stages come from the cache
+        Shader pipeline;
+        glGenProgramPipelines(1, &pipeline.Pipeline);
+        addStage(pipeline, GL_VERTEX_SHADER, vertexPath, defines);
+        addStage(pipeline, GL_FRAGMENT_SHADER, fragmentPath, defines);
+        if (geometryPath != nullptr)
+            addStage(pipeline, GL_GEOMETRY_SHADER, geometryPath, defines);
+        pipeline.reflect();
+        GLDebug::current().label(GL_PROGRAM_PIPELINE, pipeline.Pipeline, permutation.label());
+        return entries.emplace(key, Entry{PIPELINE, permutation, pipeline}).first->second.shader;
+    }
+
+    // whether get() builds program pipelines, the context has to be current
+    bool separableProgramsSupported() const
+    {
+        return UseSeparablePrograms && GLAD_GL_VERSION_4_1;
+    }
+
+    // replaces the program of a PROGRAM or STAGE entry, pipelines using a replaced stage are updated
+    // ------------------------------------------------------------------------
+    void replaceProgram(Entry& entry, unsigned int program, const std::vector<std::string>& dependencies)
+    {
+        unsigned int previous = entry.shader.ID;
+        entry.shader.ID = program;
+        entry.shader.Dependencies = dependencies;
+        entry.shader.reflect();
+        GLDebug::current().label(GL_PROGRAM, program, entry.permutation.label());
+        if (entry.type == STAGE)
+        {
+            GLbitfield stageBit = !entry.permutation.vertexPath.empty() ? GL_VERTEX_SHADER_BIT :
+                !entry.permutation.fragmentPath.empty() ? GL_FRAGMENT_SHADER_BIT : GL_GEOMETRY_SHADER_BIT;
+            for (auto& other : entries)
+            {
+                Shader& pipeline = other.second.shader;
+                if (other.second.type != PIPELINE)
+                    continue;
+                std::replace(pipeline.Stages.begin(), pipeline.Stages.end(), previous, program);
+                if (std::find(pipeline.Stages.begin(), pipeline.Stages.end(), program) != pipeline.Stages.end())
+                {
+                    glUseProgramStages(pipeline.Pipeline, stageBit, program);
+                    pipeline.reflect();
+                }
+            }
+        }
+        glDeleteProgram(previous);
+        // the deleted program may still be current, the shadowed bindings cannot be trusted anymore
+        GLState::current().invalidate();
+    }
+
+    // cached permutations by key, the key is stable for the lifetime of the cache
+    std::unordered_map<std::string, Entry>& all()
+    {
+        return entries;
+    }
+    Entry* find(const std::string& key)
+    {
+        auto it = entries.find(key);
+        return it == entries.end() ? nullptr : &it->second;
+    }
+
+    // number of compiled permutations, stage programs included
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    // deletes all programs and pipelines, the context has to be current
+    void clear()
+    {
+        for (auto& entry : entries)
+        {
+            if (entry.second.type == PIPELINE)
+                glDeleteProgramPipelines(1, &entry.second.shader.Pipeline);
+            else
+                glDeleteProgram(entry.second.shader.ID);
+        }
+        entries.clear();
+        GLState::current().invalidate();
+    }
+
+private:
+    std::unordered_map<std::string, Entry> entries;
+
+    // attaches the separable program of one stage to the pipeline, compiling it on demand
+    void addStage(Shader& pipeline, GLenum type, const char* path, const ShaderDefines& defines)
+    {
+        // defines the stage never mentions cannot change it, leaving them out of the key lets pipelines share it
+        ShaderPreprocessor preprocessor;
+        std::string code;
+        preprocessor.process(path, ShaderDefines(), code);
+        ShaderPermutation permutation;
+        permutation.separable = true;
+        permutation.defines["SEPARABLE_PROGRAM"] = "";
+        for (const auto& define : defines)
+            if (code.find(define.first) != std::string::npos)
+                permutation.defines.insert(define);
+        (type == GL_VERTEX_SHADER ? permutation.vertexPath : type == GL_FRAGMENT_SHADER ? permutation.fragmentPath : permutation.geometryPath) = path;
+
+        std::string key = "stage|" + std::to_string(type) + "|" + path + "|" + ShaderPreprocessor::definesKey(permutation.defines);
+        auto it = entries.find(key);
+        if (it == entries.end())
+        {
+            ShaderSources sources;
+            permutation.load(sources);
+            it = entries.emplace(key, Entry{STAGE, permutation, Shader(sources)}).first;
+            GLDebug::current().label(GL_PROGRAM, it->second.shader.ID, permutation.label());
+        }
+
+        unsigned int stage = it->second.shader.ID;
+        GLbitfield stageBit = type == GL_VERTEX_SHADER ? GL_VERTEX_SHADER_BIT : type == GL_FRAGMENT_SHADER ? GL_FRAGMENT_SHADER_BIT : GL_GEOMETRY_SHADER_BIT;
+        glUseProgramStages(pipeline.Pipeline, stageBit, stage);
+        pipeline.Stages.push_back(stage);
+        for (const std::string& file : it->second.shader.Dependencies)
+            if (std::find(pipeline.Dependencies.begin(), pipeline.Dependencies.end(), file) == pipeline.Dependencies.end())
+                pipeline.Dependencies.push_back(file);
+    }
+};
+#endif
@@ -0,0 +1,336 @@
+#ifndef SHADER_PARAMETERS_H
+#define SHADER_PARAMETERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "shader.h"
+
+// scalar type of the values a C++ type holds, 0 for types that cannot be a uniform value
+template <typename T>
+struct ParameterComponent
+{
+    static const GLenum value = 0;
+};
+template <>
+struct ParameterComponent<float>
+{
+    static const GLenum value = GL_FLOAT;
+};
+template <>
+struct ParameterComponent<int>
+{
+    static const GLenum value = GL_INT;
+};
+template <>
+struct ParameterComponent<unsigned int>
+{
+    static const GLenum value = GL_UNSIGNED_INT;
+};
+template <typename T, size_t N>
+struct ParameterComponent<T[N]> : ParameterComponent<T>
+{
+};
+template <glm::length_t L, typename T, glm::qualifier Q>
+struct ParameterComponent<glm::vec<L, T, Q>> : ParameterComponent<T>
+{
+};
+template <glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+struct ParameterComponent<glm::mat<C, R, T, Q>> : ParameterComponent<T>
+{
+};
+
+// Per-draw uniform values of one shader, packed into a byte buffer laid out from the shader reflection.
+// Values for uniforms the program does not use are dropped when they are set, and upload() only writes
+// the uniforms whose value changed since their last upload. A value is only stored if its scalar type matches
+// the uniform and it fills one element or the whole array. A reloaded shader is picked up automatically, a uniform
+// whose type or array size changed starts over from zero.
+class ShaderParameters
+{
+public:
+    // uniform writes issued and skipped by upload() since construction
+    unsigned int UploadedCount = 0;
+    unsigned int SkippedCount = 0;
+
+    ShaderParameters(Shader& shader) : shader(shader)
+    {
+    }
+
+    // slot of a uniform for the set() overloads taking a slot, -1 if the program does not use it
+    // ------------------------------------------------------------------------
+    int find(const std::string& name)
+    {
+        syncLayout();
+        auto it = names.find(name);
+        if (it != names.end())
+            return it->second;
+        const std::vector<size_t>* uniforms = shader.Reflection.findUniform(name);
+        int slot = -1;
+        const UniformInfo* uniform = uniforms != nullptr ? &shader.Reflection.Uniforms[uniforms->front()] : nullptr;
+        if (uniform != nullptr && supported(*uniform))
+        {
+            slot = (int)slots.size();
+            Slot added;
+            added.name = name;
+            added.type = uniform->type;
+            added.count = uniform->size;
+            added.offset = values.size();
+            added.size = typeSize(uniform->type) * uniform->size;
+            added.dirty = false;
+            added.reported = false;
+            added.targets = *uniforms;
+            slots.push_back(added);
+            values.resize(values.size() + added.size, 0);
+        }
+        names[name] = slot;
+        return slot;
+    }
+
+    // stores a value, it is written by the next upload() if it differs from the uploaded one
+    // ------------------------------------------------------------------------
+    template <typename T>
+    void set(int slot, const T& value)
+    {
+        setData(slot, &value, sizeof(T), ParameterComponent<T>::value);
+    }
+    void set(int slot, bool value)
+    {
+        int data = value;
+        setData(slot, &data, sizeof(int), GL_INT);
+    }
+    void set(int slot, double value)
+    {
+        float data = (float)value;
+        setData(slot, &data, sizeof(float), GL_FLOAT);
+    }
+    template <typename T>
+    void set(const std::string& name, const T& value)
+    {
+        set(find(name), value);
+    }
+
+    // writes the changed values, the shader has to be in use
+    // ------------------------------------------------------------------------
+    void upload()
+    {
+        syncLayout();
+        for (Slot& slot : slots)
+        {
+            if (!slot.dirty)
+            {
+                SkippedCount++;
+                continue;
+            }
+            slot.dirty = false;
+            const void* data = &values[slot.offset];
+            for (size_t index : slot.targets)
+            {
+                const UniformInfo& uniform = shader.Reflection.Uniforms[index];
+                if (uniform.location == -1)
+                    continue;
+                if (shader.Pipeline != 0)
+                    glActiveShaderProgram(shader.Pipeline, uniform.program);
+                write(slot.type, uniform.location, slot.count, data);
+                UploadedCount++;
+                FrameStats::current().countUniform(slot.size);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::string name;
+        GLenum type;
+        GLint count;
+        size_t offset;
+        size_t size;
+        bool dirty;
+        // a type mismatch was reported
+        bool reported;
+        std::vector<size_t> targets;
+    };
+
+    Shader& shader;
+    unsigned int generation = 0;
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, int> names;
+    std::vector<unsigned char> values;
+
+    // the value has to be of the scalar type of the uniform, bools are stored as ints, and fill one element or
+    // the whole array; anything else is dropped
+    void setData(int slot, const void* data, size_t size, GLenum component)
+    {
+        if (slot < 0)
+            return;
+        syncLayout();
+        Slot& target = slots[slot];
+        GLenum expected = componentOf(target.type);
+        bool matching = component == expected || (component == GL_INT && expected == GL_BOOL);
+        if (!matching || (size != typeSize(target.type) && size != target.size))
+        {
+#ifndef NDEBUG
+            if (!target.reported)
+                std::cout << "ERROR::SHADER_PARAMETERS::TYPE_MISMATCH: " << target.name << " (type 0x" << std::hex << target.type << std::dec
+                    << ", " << target.size << " bytes) set with " << size << " bytes" << std::endl;
+#endif
+            target.reported = true;
+            return;
+        }
+        if (std::memcmp(&values[target.offset], data, size) == 0)
+            return;
+        std::memcpy(&values[target.offset], data, size);
+        target.dirty = true;
+    }
+
+    // a reloaded program has new locations and lost its values, so every slot is resolved and written again.
+    // A uniform whose type or array size changed is packed anew with a zero value, one whose new type is not
+    // supported is dropped like a uniform the program no longer uses
+    // ------------------------------------------------------------------------
+    void syncLayout()
+    {
+        if (generation == shader.Generation)
+            return;
+        generation = shader.Generation;
+        // bytes of the old value each slot keeps
+        std::vector<size_t> kept(slots.size());
+        bool repack = false;
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            Slot& slot = slots[i];
+            slot.dirty = true;
+            kept[i] = slot.size;
+            const std::vector<size_t>* uniforms = shader.Reflection.findUniform(slot.name);
+            const UniformInfo* uniform = uniforms != nullptr ? &shader.Reflection.Uniforms[uniforms->front()] : nullptr;
+            if (uniform == nullptr || !supported(*uniform))
+            {
+                slot.targets.clear();
+                continue;
+            }
+            slot.targets = *uniforms;
+            if (uniform->type == slot.type && uniform->size == slot.count)
+                continue;
+            kept[i] = uniform->type == slot.type ? std::min(slot.size, typeSize(uniform->type) * uniform->size) : 0;
+            slot.type = uniform->type;
+            slot.count = uniform->size;
+            slot.size = typeSize(uniform->type) * uniform->size;
+            slot.reported = false;
+            repack = true;
+        }
+        if (repack)
+        {
+            std::vector<unsigned char> packed;
+            for (size_t i = 0; i < slots.size(); i++)
+            {
+                size_t offset = packed.size();
+                packed.resize(offset + slots[i].size, 0);
+                std::memcpy(packed.data() + offset, &values[slots[i].offset], kept[i]);
+                slots[i].offset = offset;
+            }
+            values.swap(packed);
+        }
+        // uniforms that were unused before may be active now
+        for (auto it = names.begin(); it != names.end();)
+            it = it->second < 0 ? names.erase(it) : ++it;
+    }
+
+    // reports uniforms of a type that is not handled, e.g. doubles, once per layout
+    bool supported(const UniformInfo& uniform) const
+    {
+        if (componentOf(uniform.type) != 0)
+            return true;
+        std::cout << "ERROR::SHADER_PARAMETERS::UNSUPPORTED_TYPE: " << uniform.name << " (type 0x" << std::hex << uniform.type << std::dec
+            << ", program " << shader.ID << ")" << std::endl;
+        return false;
+    }
+
+    // scalar type of a uniform type, samplers and images are ints; 0 for the types not handled
+    static GLenum componentOf(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+        case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+            return GL_FLOAT;
+        case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+            return GL_INT;
+        case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+            return GL_UNSIGNED_INT;
+        case GL_BOOL: case GL_BOOL_VEC2: case GL_BOOL_VEC3: case GL_BOOL_VEC4:
+            return GL_BOOL;
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE_MAP_ARRAY: case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_CUBE:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        case GL_IMAGE_2D: case GL_IMAGE_3D: case GL_IMAGE_CUBE: case GL_IMAGE_2D_ARRAY: case GL_IMAGE_BUFFER:
+        case GL_INT_IMAGE_2D: case GL_UNSIGNED_INT_IMAGE_2D:
+            return GL_INT;
+        default:
+            return 0;
+        }
+    }
+
+    // bytes of one element
+    static size_t typeSize(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: return 8;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3: return 12;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2: return 16;
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: return 24;
+        case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: return 32;
+        case GL_FLOAT_MAT3: return 36;
+        case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3: return 48;
+        case GL_FLOAT_MAT4: return 64;
+        // float, int, uint, bool, samplers and images
+        default: return 4;
+        }
+    }
+
+    static void write(GLenum type, GLint location, GLint count, const void* data)
+    {
+        const GLfloat* floats = (const GLfloat*)data;
+        const GLint* ints = (const GLint*)data;
+        const GLuint* uints = (const GLuint*)data;
+        switch (type)
+        {
+        case GL_FLOAT: glUniform1fv(location, count, floats); break;
+        case GL_FLOAT_VEC2: glUniform2fv(location, count, floats); break;
+        case GL_FLOAT_VEC3: glUniform3fv(location, count, floats); break;
+        case GL_FLOAT_VEC4: glUniform4fv(location, count, floats); break;
+        case GL_FLOAT_MAT2: glUniformMatrix2fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT3: glUniformMatrix3fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT4: glUniformMatrix4fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT2x3: glUniformMatrix2x3fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT2x4: glUniformMatrix2x4fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT3x2: glUniformMatrix3x2fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT3x4: glUniformMatrix3x4fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT4x2: glUniformMatrix4x2fv(location, count, GL_FALSE, floats); break;
+        case GL_FLOAT_MAT4x3: glUniformMatrix4x3fv(location, count, GL_FALSE, floats); break;
+        case GL_UNSIGNED_INT: glUniform1uiv(location, count, uints); break;
+        case GL_UNSIGNED_INT_VEC2: glUniform2uiv(location, count, uints); break;
+        case GL_UNSIGNED_INT_VEC3: glUniform3uiv(location, count, uints); break;
+        case GL_UNSIGNED_INT_VEC4: glUniform4uiv(location, count, uints); break;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: glUniform2iv(location, count, ints); break;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: glUniform3iv(location, count, ints); break;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: glUniform4iv(location, count, ints); break;
+        // int, bool, samplers and images, find() gives no slot to any other type
+        default: glUniform1iv(location, count, ints); break;
+        }
+    }
+};
+#endif
@@ -0,0 +1,242 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+// Preprocessor defines injected into a shader permutation, NAME -> VALUE (the value may be empty).
+// An ordered map keeps the generated source and the permutation key independent of insertion order.
+typedef std::map<std::string, std::string> ShaderDefines;
+
+// a shader compiled into the executable with its includes already resolved, see src/tools/embed_shaders.cpp
+struct EmbeddedShader
+{
+    const char* name;
+    const char* source;
+};
+
+// Expands #include "file" directives and injects a define set right after the #version line.
+// Every file is included at most once, and #line directives keep compiler messages pointing at the original
+// file and line: the source string number N refers to Files[N].
+// Shader names are looked up in the embedded sources if there are any, otherwise or when a source directory is set
+// they are read from disk relative to that directory.
+// This class does not touch OpenGL, so it can be used by build time tools as well.
+class ShaderPreprocessor
+{
+public:
+    // all files that took part in the last process() call, the first one is the root file
+    std::vector<std::string> Files;
+
+    // registers the sources compiled into the executable
+    static void setEmbeddedSources(const EmbeddedShader* shaders, size_t count)
+    {
+        config().embedded = shaders;
+        config().embeddedCount = count;
+    }
+    // reads shaders from this directory instead of the embedded sources, meant for development and hot reload
+    static void setSourceDirectory(const std::string &directory)
+    {
+        config().directory = directory;
+        if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+            config().directory += '/';
+    }
+    static const std::string& sourceDirectory()
+    {
+        return config().directory;
+    }
+    // true if shaders are read from files and may change at runtime
+    static bool readsFiles()
+    {
+        return config().embedded == nullptr || !config().directory.empty();
+    }
+
+    // preprocesses the shader at path, returns false if the file or one of its includes could not be read
+    bool process(const std::string &path, const ShaderDefines &defines, std::string &result)
+    {
+        Files.clear();
+        includeStack.clear();
+        std::string body;
+        if (!expand(path, body))
+            return false;
+        result = injectDefines(body, defines);
+        return true;
+    }
+
+    // inserts the defines right after the #version line, #version has to stay the first directive
+    static std::string injectDefines(const std::string &source, const ShaderDefines &defines)
+    {
+        if (defines.empty())
+            return source;
+        std::string header;
+        std::string body = source;
+        size_t versionStart = findVersionDirective(body);
+        if (versionStart != std::string::npos)
+        {
+            size_t versionEnd = body.find('\n', versionStart);
+            versionEnd = versionEnd == std::string::npos ? body.size() : versionEnd + 1;
+            header = body.substr(0, versionEnd);
+            if (header.back() != '\n')
+                header += '\n';
+            body = body.substr(versionEnd);
+        }
+        std::string result = header;
+        for (const auto &define : defines)
+            result += "#define " + define.first + (define.second.empty() ? "" : " " + define.second) + "\n";
+        result += "#line " + std::to_string(countLines(header) + 1) + " 0\n";
+        return result + body;
+    }
+
+    // reads a whole file into result
+    static bool readFile(const std::string &path, std::string &result)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        result = stream.str();
+        return true;
+    }
+
+    // returns a key that identifies a define set, used to cache permutations
+    static std::string definesKey(const ShaderDefines &defines)
+    {
+        std::string key;
+        for (const auto &define : defines)
+            key += define.first + "=" + define.second + ";";
+        return key;
+    }
+
+    // directory part of a path including the trailing separator, empty for a bare file name
+    static std::string directoryOf(const std::string &path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+private:
+    struct Config
+    {
+        const EmbeddedShader* embedded = nullptr;
+        size_t embeddedCount = 0;
+        std::string directory;
+    };
+    static Config& config()
+    {
+        static Config instance;
+        return instance;
+    }
+
+    std::vector<std::string> includeStack;
+
+    // fetches the source of a shader name, file is the path it was read from or the name of the embedded source
+    static bool loadSource(const std::string &name, std::string &file, std::string &source)
+    {
+        const Config& current = config();
+        if (readsFiles())
+        {
+            file = current.directory + name;
+            return readFile(file, source);
+        }
+        file = name;
+        for (size_t i = 0; i < current.embeddedCount; i++)
+        {
+            if (name == current.embedded[i].name)
+            {
+                source = current.embedded[i].source;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool expand(const std::string &path, std::string &result)
+    {
+        std::string file;
+        std::string source;
+        if (!loadSource(path, file, source))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << file << std::endl;
+            return false;
+        }
+        if (std::find(includeStack.begin(), includeStack.end(), file) != includeStack.end())
+        {
+            std::cout << "ERROR::SHADER::RECURSIVE_INCLUDE: " << file << std::endl;
+            return false;
+        }
+        int fileIndex = (int)Files.size();
+        Files.push_back(file);
+        includeStack.push_back(file);
+
+        std::istringstream lines(source);
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(lines, line))
+        {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            std::string includePath;
+            if (!parseInclude(line, includePath))
+            {
+                result += line + "\n";
+                continue;
+            }
+            includePath = directoryOf(path) + includePath;
+            // already included files are skipped, which makes include guards unnecessary
+            if (std::find(Files.begin(), Files.end(), config().directory + includePath) == Files.end())
+            {
+                result += "#line 1 " + std::to_string(Files.size()) + "\n";
+                if (!expand(includePath, result))
+                    return false;
+            }
+            result += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+        }
+        includeStack.pop_back();
+        return true;
+    }
+
+    // matches  #include "file"  and returns the quoted file name
+    static bool parseInclude(const std::string &line, std::string &includePath)
+    {
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line[pos] != '#')
+            return false;
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+            return false;
+        size_t open = line.find('"', pos + 7);
+        size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+        if (close == std::string::npos)
+            return false;
+        includePath = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
+    static size_t findVersionDirective(const std::string &source)
+    {
+        size_t lineStart = 0;
+        while (lineStart < source.size())
+        {
+            size_t pos = source.find_first_not_of(" \t", lineStart);
+            if (pos != std::string::npos && source.compare(pos, 8, "#version") == 0)
+                return lineStart;
+            size_t next = source.find('\n', lineStart);
+            if (next == std::string::npos)
+                break;
+            lineStart = next + 1;
+        }
+        return std::string::npos;
+    }
+
+    static int countLines(const std::string &text)
+    {
+        return (int)std::count(text.begin(), text.end(), '\n');
+    }
+};
+#endif
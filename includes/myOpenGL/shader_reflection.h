@@ -0,0 +1,183 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+// an active uniform, members of uniform blocks have no location but an offset into their block
+struct UniformInfo
+{
+    std::string name;
+    GLenum type;
+    GLint size;
+    GLint location;
+    GLint blockIndex;
+    GLint offset;
+    GLint arrayStride;
+    GLint matrixStride;
+    unsigned int program;
+};
+
+struct UniformBlockInfo
+{
+    std::string name;
+    GLuint index;
+    GLint dataSize;
+    GLint binding;
+    unsigned int program;
+};
+
+struct AttributeInfo
+{
+    std::string name;
+    GLenum type;
+    GLint size;
+    GLint location;
+};
+
+// Interface of linked programs as reported by the driver: active uniforms, uniform blocks, samplers and vertex
+// attributes. Several programs can be reflected into one instance, e.g. the stages of a program pipeline, so a
+// name may resolve to one uniform per program.
+class ShaderReflection
+{
+public:
+    std::vector<UniformInfo> Uniforms;
+    std::vector<UniformBlockInfo> UniformBlocks;
+    // indices into Uniforms of the sampler uniforms
+    std::vector<size_t> Samplers;
+    std::vector<AttributeInfo> Attributes;
+
+    void clear()
+    {
+        Uniforms.clear();
+        UniformBlocks.clear();
+        Samplers.clear();
+        Attributes.clear();
+        uniformIndex.clear();
+    }
+
+    // adds the interface of a linked program
+    // ------------------------------------------------------------------------
+    void reflect(unsigned int program)
+    {
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE)
+            return;
+        GLchar name[256];
+
+        GLint count = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for (GLuint i = 0; i < (GLuint)count; i++)
+        {
+            UniformInfo uniform;
+            glGetActiveUniform(program, i, sizeof(name), nullptr, &uniform.size, &uniform.type, name);
+            uniform.name = name;
+            uniform.location = glGetUniformLocation(program, name);
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &uniform.blockIndex);
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_OFFSET, &uniform.offset);
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_ARRAY_STRIDE, &uniform.arrayStride);
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_MATRIX_STRIDE, &uniform.matrixStride);
+            uniform.program = program;
+            if (isSampler(uniform.type))
+                Samplers.push_back(Uniforms.size());
+            addToIndex(uniform.name, Uniforms.size());
+            // arrays are reported as name[0], they can be set through their plain name as well
+            size_t bracket = uniform.name.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == uniform.name.size())
+                addToIndex(uniform.name.substr(0, bracket), Uniforms.size());
+            Uniforms.push_back(uniform);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for (GLuint i = 0; i < (GLuint)count; i++)
+        {
+            UniformBlockInfo block;
+            glGetActiveUniformBlockName(program, i, sizeof(name), nullptr, name);
+            block.name = name;
+            block.index = i;
+            glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+            glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+            block.program = program;
+            UniformBlocks.push_back(block);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        for (GLuint i = 0; i < (GLuint)count; i++)
+        {
+            AttributeInfo attribute;
+            glGetActiveAttrib(program, i, sizeof(name), nullptr, &attribute.size, &attribute.type, name);
+            attribute.name = name;
+            attribute.location = glGetAttribLocation(program, name);
+            Attributes.push_back(attribute);
+        }
+    }
+
+    // indices into Uniforms of all uniforms with this name, nullptr if no reflected program uses it
+    const std::vector<size_t>* findUniform(const std::string& name) const
+    {
+        auto it = uniformIndex.find(name);
+        return it == uniformIndex.end() ? nullptr : &it->second;
+    }
+    const UniformBlockInfo* findUniformBlock(const std::string& name) const
+    {
+        for (const UniformBlockInfo& block : UniformBlocks)
+            if (block.name == name)
+                return &block;
+        return nullptr;
+    }
+    const AttributeInfo* findAttribute(const std::string& name) const
+    {
+        for (const AttributeInfo& attribute : Attributes)
+            if (attribute.name == name)
+                return &attribute;
+        return nullptr;
+    }
+
+    // prints the reflected interface, useful when a permutation does not behave as expected
+    void print(std::ostream& out = std::cout) const
+    {
+        for (const UniformInfo& uniform : Uniforms)
+        {
+            out << "uniform " << uniform.name << " type 0x" << std::hex << uniform.type << std::dec << " size " << uniform.size;
+            if (uniform.blockIndex >= 0)
+                out << " block " << uniform.blockIndex << " offset " << uniform.offset;
+            else
+                out << " location " << uniform.location;
+            out << " program " << uniform.program << "\n";
+        }
+        for (const UniformBlockInfo& block : UniformBlocks)
+            out << "block " << block.name << " size " << block.dataSize << " binding " << block.binding << " program " << block.program << "\n";
+        for (const AttributeInfo& attribute : Attributes)
+            out << "attribute " << attribute.name << " type 0x" << std::hex << attribute.type << std::dec << " location " << attribute.location << "\n";
+    }
+
+    static bool isSampler(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT:
+        case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+private:
+    std::unordered_map<std::string, std::vector<size_t>> uniformIndex;
+
+    void addToIndex(const std::string& name, size_t index)
+    {
+        uniformIndex[name].push_back(index);
+    }
+};
+#endif
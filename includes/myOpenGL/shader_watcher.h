@@ -0,0 +1,265 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "shader_cache.h"
+#include "cpu_trace.h"
+
+// Hot reload for the programs of a ShaderCache.
+// A background thread watches the directories of all shader sources and their includes with inotify,
+// and preprocesses the permutations affected by a change. update() then compiles them without waiting for the
+// driver and, once a build has completed, swaps the new program in. A program that fails to build is dropped
+// and the previous one stays in use.
+class ShaderWatcher
+{
+public:
+    // called from update() after at least one program has been replaced, e.g. to set the static uniforms again
+    std::function<void()> OnReload;
+
+    ShaderWatcher(ShaderCache& cache) : cache(cache), running(false)
+    {
+    }
+    ~ShaderWatcher()
+    {
+        stop();
+    }
+
+    // starts watching, returns false if file watching is not available on this platform
+    // ------------------------------------------------------------------------
+    bool start()
+    {
+#ifdef __linux__
+        if (running)
+            return true;
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+        {
+            std::cout << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+            return false;
+        }
+        running = true;
+        syncPermutations();
+        worker = std::thread(&ShaderWatcher::watch, this);
+        return true;
+#else
+        std::cout << "shader hot reload is only supported on Linux" << std::endl;
+        return false;
+#endif
+    }
+
+    // stops the background thread, pending builds are discarded
+    // ------------------------------------------------------------------------
+    void stop()
+    {
+#ifdef __linux__
+        if (!running)
+            return;
+        running = false;
+        worker.join();
+        close(inotifyFd);
+        inotifyFd = -1;
+        for (auto& pending : building)
+        {
+            Shader::finishBuild(pending.second);
+            glDeleteProgram(pending.second.program);
+        }
+        building.clear();
+#endif
+    }
+
+    // call once per frame on the thread owning the GL context, outside of any pass
+    // ------------------------------------------------------------------------
+    void update()
+    {
+        if (!running)
+            return;
+        if (cache.size() != knownPermutations)
+            syncPermutations();
+
+        // start building the sources the worker prepared, a newer build replaces an older one
+        std::vector<PreparedSources> jobs;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.swap(prepared);
+        }
+        for (PreparedSources& job : jobs)
+        {
+            auto previous = building.find(job.key);
+            if (previous != building.end())
+            {
+                Shader::finishBuild(previous->second);
+                glDeleteProgram(previous->second.program);
+                building.erase(previous);
+            }
+            building.emplace(job.key, Shader::beginBuild(job.sources));
+        }
+
+        // swap in the programs the driver has finished
+        bool reloaded = false;
+        for (auto it = building.begin(); it != building.end();)
+        {
+            if (!Shader::buildCompleted(it->second))
+            {
+                ++it;
+                continue;
+            }
+            ShaderCache::Entry* entry = cache.find(it->first);
+            if (Shader::finishBuild(it->second) && entry != nullptr)
+            {
+                cache.replaceProgram(*entry, it->second.program, it->second.sources.dependencies());
+                std::cout << "shader reloaded: " << it->first << std::endl;
+                reloaded = true;
+            }
+            else
+            {
+                if (entry == nullptr)
+                    glDeleteProgram(it->second.program);
+                std::cout << "shader reload failed, keeping the previous program: " << it->first << std::endl;
+            }
+            it = building.erase(it);
+        }
+        if (reloaded)
+        {
+            // an edit may have added includes from other directories
+            syncPermutations();
+            if (OnReload)
+                OnReload();
+        }
+    }
+
+private:
+    struct PreparedSources
+    {
+        std::string key;
+        ShaderSources sources;
+    };
+    struct WatchedPermutation
+    {
+        ShaderPermutation permutation;
+        std::vector<std::string> dependencies;
+    };
+
+    ShaderCache& cache;
+    size_t knownPermutations = 0;
+    std::unordered_map<std::string, ShaderBuild> building;
+
+    // shared with the worker thread, guarded by mutex
+    std::mutex mutex;
+    std::unordered_map<std::string, WatchedPermutation> permutations;
+    std::unordered_map<int, std::string> watchedDirectories;
+    std::vector<PreparedSources> prepared;
+
+    std::thread worker;
+    std::atomic<bool> running;
+    int inotifyFd = -1;
+
+    // hands the current permutations and their dependencies to the worker and watches their directories
+    void syncPermutations()
+    {
+#ifdef __linux__
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& cached : cache.all())
+        {
+            // pipelines are updated through their stages
+            if (cached.second.type == ShaderCache::PIPELINE)
+                continue;
+            WatchedPermutation& watched = permutations[cached.first];
+            watched.permutation = cached.second.permutation;
+            watched.dependencies = cached.second.shader.Dependencies;
+            for (const std::string& file : watched.dependencies)
+            {
+                std::string directory = ShaderPreprocessor::directoryOf(file);
+                // watching a directory again returns the same descriptor
+                int wd = inotify_add_watch(inotifyFd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (wd >= 0)
+                    watchedDirectories[wd] = directory;
+            }
+        }
+        knownPermutations = cache.size();
+#endif
+    }
+
+    // worker thread: collects changed files, waits until writes settle and preprocesses the affected permutations
+    void watch()
+    {
+        CpuTrace::global().setThreadName("shader watcher");
+#ifdef __linux__
+        std::set<std::string> changed;
+        alignas(struct inotify_event) char buffer[4096];
+        while (running)
+        {
+            pollfd descriptor = {inotifyFd, POLLIN, 0};
+            // editors often write a file in several steps, so a change is only handled after a quiet period
+            int ready = poll(&descriptor, 1, changed.empty() ? 100 : 50);
+            if (ready > 0)
+            {
+                ssize_t length;
+                while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char* pointer = buffer; pointer < buffer + length;)
+                    {
+                        const inotify_event* event = (const inotify_event*)pointer;
+                        pointer += sizeof(inotify_event) + event->len;
+                        if (event->len == 0)
+                            continue;
+                        std::lock_guard<std::mutex> lock(mutex);
+                        auto directory = watchedDirectories.find(event->wd);
+                        if (directory != watchedDirectories.end())
+                            changed.insert(directory->second + event->name);
+                    }
+                }
+                continue;
+            }
+            if (changed.empty())
+                continue;
+
+            std::vector<std::pair<std::string, ShaderPermutation>> affected;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& watched : permutations)
+                    for (const std::string& file : watched.second.dependencies)
+                        if (changed.count(file))
+                        {
+                            affected.emplace_back(watched.first, watched.second.permutation);
+                            break;
+                        }
+            }
+            changed.clear();
+
+            // file reading and preprocessing stay off the render thread
+            CpuTrace::Scope trace("preprocess shaders");
+            std::vector<PreparedSources> jobs;
+            for (auto& permutation : affected)
+            {
+                PreparedSources job;
+                job.key = permutation.first;
+                if (permutation.second.load(job.sources))
+                    jobs.push_back(job);
+                else
+                    std::cout << "shader reload failed, keeping the previous program: " << job.key << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            for (PreparedSources& job : jobs)
+                prepared.push_back(job);
+        }
+#endif
+    }
+};
+#endif
@@ -0,0 +1,194 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "frame_stats.h"
+#include "gl_debug.h"
+
+// a range of the stream buffer the CPU writes this frame
+struct StreamAllocation
+{
+    void* data;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+// Ring of FRAME_COUNT regions for data that changes every frame. The CPU writes the region of the current frame
+// while the GPU still reads the previous ones, a fence per region tells when it can be written again, so neither
+// orphaning nor an implicit synchronization of glBufferData/glBufferSubData is involved.
+// With GL 4.4 the buffer is mapped once, persistent and coherent, and writes are visible to the next draw.
+// Older contexts map the region of the frame unsynchronized in beginFrame() and unmap it in flush().
+// Per frame: beginFrame(), allocate() or write(), flush() before the first draw reading the data, endFrame()
+// after the last one.
+class StreamBuffer
+{
+public:
+    static const int FRAME_COUNT = 3;
+
+    unsigned int Buffer = 0;
+    // false for the map/unmap fallback
+    bool Persistent = false;
+    // frames that had to wait for the GPU to release their region
+    unsigned int Stalls = 0;
+
+    static bool persistentMappingSupported()
+    {
+        return GLAD_GL_VERSION_4_4;
+    }
+
+    // allocations are aligned to alignment, e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks
+    // ------------------------------------------------------------------------
+    void create(GLenum target, GLsizeiptr frameSize, GLsizeiptr alignment = 16)
+    {
+        this->target = target;
+        this->alignment = alignment;
+        regionSize = align(frameSize);
+        Persistent = persistentMappingSupported();
+        glGenBuffers(1, &Buffer);
+        glBindBuffer(target, Buffer);
+        if (Persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(target, regionSize * FRAME_COUNT, nullptr, flags);
+            mapped = (char*)glMapBufferRange(target, 0, regionSize * FRAME_COUNT, flags);
+        }
+        else
+            glBufferData(target, regionSize * FRAME_COUNT, nullptr, GL_STREAM_DRAW);
+        for (GLsync& fence : fences)
+            fence = nullptr;
+        region = FRAME_COUNT - 1;
+    }
+
+    // deletes the buffer and the fences, the context has to be current
+    void destroy()
+    {
+        if (Buffer == 0)
+            return;
+        for (GLsync& fence : fences)
+        {
+            if (fence != nullptr)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+        glBindBuffer(target, Buffer);
+        if (mapped != nullptr || regionData != nullptr)
+            glUnmapBuffer(target);
+        glDeleteBuffers(1, &Buffer);
+        Buffer = 0;
+        mapped = regionData = nullptr;
+        writable = false;
+    }
+
+    // moves on to the next region, waiting for the GPU if it still reads it
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        region = (region + 1) % FRAME_COUNT;
+        used = 0;
+        GLsync& fence = fences[region];
+        if (fence != nullptr)
+        {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                Stalls++;
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                    ;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (Persistent)
+            regionData = mapped + region * regionSize;
+        else
+        {
+            glBindBuffer(target, Buffer);
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+            regionData = (char*)glMapBufferRange(target, region * regionSize, regionSize, flags);
+        }
+        writable = true;
+    }
+
+    // names the buffer for KHR_debug
+    void label(const std::string& name) const
+    {
+        GLDebug::current().label(GL_BUFFER, Buffer, name);
+    }
+
+    // reserves size bytes of the current region, data is nullptr when the region is full
+    // ------------------------------------------------------------------------
+    StreamAllocation allocate(GLsizeiptr size)
+    {
+        if (!writable || used + size > regionSize)
+        {
+            std::cout << "ERROR::STREAM_BUFFER::" << (writable ? "REGION_FULL" : "NOT_WRITABLE") << std::endl;
+            return StreamAllocation{nullptr, 0, 0};
+        }
+        StreamAllocation allocation;
+        allocation.offset = region * regionSize + used;
+        allocation.size = size;
+        allocation.data = regionData + used;
+        used += align(size);
+        return allocation;
+    }
+    template <typename T>
+    StreamAllocation write(const T& value)
+    {
+        StreamAllocation allocation = allocate(sizeof(T));
+        if (allocation.data != nullptr)
+        {
+            std::memcpy(allocation.data, &value, sizeof(T));
+            FrameStats::current().countUpload(sizeof(T));
+        }
+        return allocation;
+    }
+
+    // makes the writes of the frame visible to the GPU, nothing can be allocated afterwards
+    // ------------------------------------------------------------------------
+    void flush()
+    {
+        if (!Persistent && writable)
+        {
+            glBindBuffer(target, Buffer);
+            glFlushMappedBufferRange(target, 0, used);
+            glUnmapBuffer(target);
+            regionData = nullptr;
+        }
+        writable = false;
+    }
+
+    // the region is free again once the GPU passed the commands issued so far
+    void endFrame()
+    {
+        flush();
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // binds an allocation to an indexed binding point of the target, e.g. a uniform block binding
+    void bindRange(GLuint index, const StreamAllocation& allocation) const
+    {
+        glBindBufferRange(target, index, Buffer, allocation.offset, allocation.size);
+    }
+
+private:
+    GLenum target = GL_UNIFORM_BUFFER;
+    GLsizeiptr alignment = 16;
+    GLsizeiptr regionSize = 0;
+    GLsizeiptr used = 0;
+    int region = 0;
+    bool writable = false;
+    // the whole buffer while it is persistently mapped
+    char* mapped = nullptr;
+    char* regionData = nullptr;
+    GLsync fences[FRAME_COUNT] = {};
+
+    GLsizeiptr align(GLsizeiptr size) const
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+};
+#endif
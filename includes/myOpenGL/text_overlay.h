@@ -0,0 +1,182 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+#include "frame_stats.h"
+#include "gl_debug.h"
+#include "shader.h"
+#include "stream_buffer.h"
+
+// Lines of ASCII text drawn over the frame with a built-in 5x7 pixel font, e.g. the frame statistics. Each
+// character is a quad written into a StreamBuffer region every draw, so the GPU may still read the quads of the
+// last frames; the shader (screenQuad.vert with textOverlay.frag) darkens the cells behind the text so it stays
+// readable over a bright scene.
+class TextOverlay
+{
+public:
+    static const int FIRST_CHARACTER = 32;
+    static const int CHARACTER_COUNT = 96;
+    // a glyph cell in font pixels, one column and one row of spacing included
+    static const int CELL_WIDTH = 6;
+    static const int CELL_HEIGHT = 9;
+    static const int VERTEX_FLOATS = 5;
+    // vertices one draw can hold, 680 characters; text beyond is dropped
+    static const int MAX_VERTICES = 4096;
+
+    // font pixels per screen pixel
+    int Scale = 2;
+
+    // creates the font texture and the vertex buffer, the context has to be current
+    void create()
+    {
+        // texel row 0 is the top font row, the glyph of a character is five columns of eight bits, bit 0 at the top
+        std::vector<unsigned char> texels(CHARACTER_COUNT * CELL_WIDTH * CELL_HEIGHT, 0);
+        const unsigned char* columns = font();
+        for (int character = 0; character < CHARACTER_COUNT; character++)
+            for (int column = 0; column < 5; column++)
+                for (int row = 0; row < 8; row++)
+                    if (columns[character * 5 + column] & (1 << row))
+                        texels[row * CHARACTER_COUNT * CELL_WIDTH + character * CELL_WIDTH + column] = 255;
+
+        glGenTextures(1, &fontTexture);
+        GLState::current().bindTexture(0, GL_TEXTURE_2D, fontTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, CHARACTER_COUNT * CELL_WIDTH, CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // allocations are aligned to a vertex, so the offset of the quads is a first vertex for glDrawArrays
+        const GLsizeiptr stride = VERTEX_FLOATS * sizeof(float);
+        glGenVertexArrays(1, &VAO);
+        GLState::current().bindVertexArray(VAO);
+        vertexStream.create(GL_ARRAY_BUFFER, MAX_VERTICES * stride, stride);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(3 * sizeof(float)));
+
+        GLDebug& debug = GLDebug::current();
+        debug.label(GL_TEXTURE, fontTexture, "overlay font");
+        debug.label(GL_VERTEX_ARRAY, VAO, "overlay vertex array");
+        vertexStream.label("overlay vertices");
+    }
+    void destroy()
+    {
+        glDeleteTextures(1, &fontTexture);
+        glDeleteVertexArrays(1, &VAO);
+        vertexStream.destroy();
+        fontTexture = VAO = 0;
+        GLState::current().invalidate();
+    }
+
+    // draws the lines from the top left corner of the bound framebuffer, which is width x height pixels
+    // ------------------------------------------------------------------------
+    void draw(Shader& shader, const std::vector<std::string>& lines, int width, int height)
+    {
+        vertices.clear();
+        float cellWidth = 2.0f * CELL_WIDTH * Scale / width;
+        float cellHeight = 2.0f * CELL_HEIGHT * Scale / height;
+        for (size_t line = 0; line < lines.size(); line++)
+        {
+            float top = 1.0f - cellHeight * (line + 0.5f);
+            for (size_t column = 0; column < lines[line].size(); column++)
+            {
+                int character = (unsigned char)lines[line][column] - FIRST_CHARACTER;
+                if (character < 0 || character >= CHARACTER_COUNT)
+                    character = '?' - FIRST_CHARACTER;
+                float left = -1.0f + cellWidth * (column + 0.5f);
+                addQuad(left, top, cellWidth, cellHeight, character);
+            }
+        }
+        vertices.resize(std::min(vertices.size(), (size_t)MAX_VERTICES * VERTEX_FLOATS));
+        if (vertices.empty())
+            return;
+        vertexStream.beginFrame();
+        StreamAllocation allocation = vertexStream.allocate(vertices.size() * sizeof(float));
+        if (allocation.data == nullptr)
+        {
+            vertexStream.endFrame();
+            return;
+        }
+        std::memcpy(allocation.data, vertices.data(), vertices.size() * sizeof(float));
+        FrameStats::current().countUpload(vertices.size() * sizeof(float));
+        vertexStream.flush();
+
+        GLState& state = GLState::current();
+        state.disable(GL_DEPTH_TEST);
+        state.enable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        shader.use();
+        shader.setInt("glyphTexture", 0);
+        state.bindTexture(0, GL_TEXTURE_2D, fontTexture);
+        state.bindVertexArray(VAO);
+        GLsizei vertexCount = (GLsizei)(vertices.size() / VERTEX_FLOATS);
+        glDrawArrays(GL_TRIANGLES, (GLint)(allocation.offset / (VERTEX_FLOATS * sizeof(float))), vertexCount);
+        FrameStats::current().countDraw(vertexCount / 3);
+        vertexStream.endFrame();
+        state.disable(GL_BLEND);
+        state.enable(GL_DEPTH_TEST);
+    }
+
+private:
+    unsigned int fontTexture = 0;
+    unsigned int VAO = 0;
+    StreamBuffer vertexStream;
+    // position and uv of every vertex, reused between draws
+    std::vector<float> vertices;
+
+    void addQuad(float left, float top, float width, float height, int character)
+    {
+        float u0 = (float)character / CHARACTER_COUNT;
+        float u1 = (float)(character + 1) / CHARACTER_COUNT;
+        const float corners[6][4] = {
+            {left, top, u0, 0.0f}, {left, top - height, u0, 1.0f}, {left + width, top, u1, 0.0f},
+            {left + width, top, u1, 0.0f}, {left, top - height, u0, 1.0f}, {left + width, top - height, u1, 1.0f},
+        };
+        for (const float* corner : corners)
+            vertices.insert(vertices.end(), {corner[0], corner[1], 0.0f, corner[2], corner[3]});
+    }
+
+    // ASCII 32 to 127, five columns per glyph
+    static const unsigned char* font()
+    {
+        static const unsigned char columns[CHARACTER_COUNT * 5] = {
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00, 0x14, 0x7F, 0x14, 0x7F, 0x14, //  !"#
+            0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62, 0x36, 0x49, 0x56, 0x20, 0x50, 0x00, 0x08, 0x07, 0x03, 0x00, // $%&'
+            0x00, 0x1C, 0x22, 0x41, 0x00, 0x00, 0x41, 0x22, 0x1C, 0x00, 0x2A, 0x1C, 0x7F, 0x1C, 0x2A, 0x08, 0x08, 0x3E, 0x08, 0x08, // ()*+
+            0x00, 0x80, 0x70, 0x30, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x60, 0x60, 0x00, 0x20, 0x10, 0x08, 0x04, 0x02, // ,-./
+            0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00, 0x72, 0x49, 0x49, 0x49, 0x46, 0x21, 0x41, 0x49, 0x4D, 0x33, // 0123
+            0x18, 0x14, 0x12, 0x7F, 0x10, 0x27, 0x45, 0x45, 0x45, 0x39, 0x3C, 0x4A, 0x49, 0x49, 0x31, 0x41, 0x21, 0x11, 0x09, 0x07, // 4567
+            0x36, 0x49, 0x49, 0x49, 0x36, 0x46, 0x49, 0x49, 0x29, 0x1E, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x40, 0x34, 0x00, 0x00, // 89:;
+            0x00, 0x08, 0x14, 0x22, 0x41, 0x14, 0x14, 0x14, 0x14, 0x14, 0x00, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x59, 0x09, 0x06, // <=>?
+            0x3E, 0x41, 0x5D, 0x59, 0x4E, 0x7C, 0x12, 0x11, 0x12, 0x7C, 0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41, 0x41, 0x41, 0x22, // @ABC
+            0x7F, 0x41, 0x41, 0x41, 0x3E, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x7F, 0x09, 0x09, 0x09, 0x01, 0x3E, 0x41, 0x41, 0x51, 0x73, // DEFG
+            0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00, 0x20, 0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41, // HIJK
+            0x7F, 0x40, 0x40, 0x40, 0x40, 0x7F, 0x02, 0x1C, 0x02, 0x7F, 0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E, // LMNO
+            0x7F, 0x09, 0x09, 0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E, 0x7F, 0x09, 0x19, 0x29, 0x46, 0x26, 0x49, 0x49, 0x49, 0x32, // PQRS
+            0x03, 0x01, 0x7F, 0x01, 0x03, 0x3F, 0x40, 0x40, 0x40, 0x3F, 0x1F, 0x20, 0x40, 0x20, 0x1F, 0x3F, 0x40, 0x38, 0x40, 0x3F, // TUVW
+            0x63, 0x14, 0x08, 0x14, 0x63, 0x03, 0x04, 0x78, 0x04, 0x03, 0x61, 0x59, 0x49, 0x4D, 0x43, 0x00, 0x7F, 0x41, 0x41, 0x41, // XYZ[
+            0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x41, 0x41, 0x41, 0x7F, 0x04, 0x02, 0x01, 0x02, 0x04, 0x40, 0x40, 0x40, 0x40, 0x40, // \]^_
+            0x00, 0x03, 0x07, 0x08, 0x00, 0x20, 0x54, 0x54, 0x78, 0x40, 0x7F, 0x28, 0x44, 0x44, 0x38, 0x38, 0x44, 0x44, 0x44, 0x28, // `abc
+            0x38, 0x44, 0x44, 0x28, 0x7F, 0x38, 0x54, 0x54, 0x54, 0x18, 0x00, 0x08, 0x7E, 0x09, 0x02, 0x18, 0xA4, 0xA4, 0x9C, 0x78, // defg
+            0x7F, 0x08, 0x04, 0x04, 0x78, 0x00, 0x44, 0x7D, 0x40, 0x00, 0x20, 0x40, 0x40, 0x3D, 0x00, 0x7F, 0x10, 0x28, 0x44, 0x00, // hijk
+            0x00, 0x41, 0x7F, 0x40, 0x00, 0x7C, 0x04, 0x78, 0x04, 0x78, 0x7C, 0x08, 0x04, 0x04, 0x78, 0x38, 0x44, 0x44, 0x44, 0x38, // lmno
+            0xFC, 0x18, 0x24, 0x24, 0x18, 0x18, 0x24, 0x24, 0x18, 0xFC, 0x7C, 0x08, 0x04, 0x04, 0x08, 0x48, 0x54, 0x54, 0x54, 0x24, // pqrs
+            0x04, 0x04, 0x3F, 0x44, 0x24, 0x3C, 0x40, 0x40, 0x20, 0x7C, 0x1C, 0x20, 0x40, 0x20, 0x1C, 0x3C, 0x40, 0x30, 0x40, 0x3C, // tuvw
+            0x44, 0x28, 0x10, 0x28, 0x44, 0x4C, 0x90, 0x90, 0x90, 0x7C, 0x44, 0x64, 0x54, 0x4C, 0x44, 0x00, 0x08, 0x36, 0x41, 0x00, // xyz{
+            0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0x41, 0x36, 0x08, 0x00, 0x02, 0x01, 0x02, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, // |}~
+        };
+        return columns;
+    }
+};
+#endif
@@ -0,0 +1,92 @@
+#ifndef WORKER_THREAD_H
+#define WORKER_THREAD_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cpu_trace.h"
+
+// A thread that lives from start() to stop() and runs one job at a time, so per-frame work can go off the
+// calling thread without creating a thread every frame. run() hands over a job, wait() blocks until it is done.
+class WorkerThread
+{
+public:
+    ~WorkerThread()
+    {
+        stop();
+    }
+
+    // name is the thread name in the CPU trace
+    // ------------------------------------------------------------------------
+    void start(const std::string& name)
+    {
+        if (thread.joinable())
+            return;
+        quit = false;
+        busy = false;
+        thread = std::thread(&WorkerThread::loop, this, name);
+    }
+    // finishes the current job and joins the thread
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+    bool running() const
+    {
+        return thread.joinable();
+    }
+
+    // starts a job, the previous one has to be waited for
+    void run(std::function<void()> work)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = std::move(work);
+            busy = true;
+        }
+        wake.notify_all();
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return !busy; });
+    }
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void()> job;
+    bool busy = false;
+    bool quit = false;
+
+    void loop(std::string name)
+    {
+        CpuTrace::global().setThreadName(name);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this]() { return busy || quit; });
+            if (!busy)
+                return;
+            std::function<void()> work = std::move(job);
+            lock.unlock();
+            work();
+            lock.lock();
+            busy = false;
+            done.notify_all();
+        }
+    }
+};
+#endif
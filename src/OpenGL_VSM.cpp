@@ -1,22 +1,37 @@
 #include <glad/glad.h>
+#ifdef VSM_WINDOW
 #include <GLFW/glfw3.h>
+#endif
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
 
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/cpu_trace.h"
+#include "myOpenGL/frame_stats.h"
+#include "myOpenGL/camera_path.h"
+#include "myOpenGL/image.h"
+#ifdef VSM_HEADLESS
+#include "myOpenGL/egl_context.h"
+#include "myOpenGL/offscreen_target.h"
+#endif
+#include "vsm_renderer.h"
 
-#include "myOpenGL/camera.h"
-#include "myOpenGL/shader.h"
-
+#ifdef VSM_WINDOW
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xPos, double yPos);
 void scroll_callback(GLFWwindow *window, double xOffset, double yOffset);
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
-void renderScene(Shader& shader);
-void renderQuad();
+#endif
 
 // basic window setting
 const int SCREEN_WIDTH = 1280;
@@ -27,29 +42,182 @@ float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
 // camera control
-Camera mainCamera(glm::vec3(0.0f, 2.0f, 8.0f));
-float nearPlane = 0.1f;
-float farPlane = 50.0f;
 float lastX = (float)SCREEN_WIDTH / 2.0f;
 float lastY = (float)SCREEN_HEIGHT / 2.0f;
 bool firstMouse = true;
 
-// render setting
-const int DEPTH_MAP_WIDTH = 1024;
-const int DEPTH_MAP_HEIGHT = 1024;
+VsmRenderer renderer;
+// where T writes the trace
+std::string traceOutputPath;
+
+// command line options, the headless mode renders a fixed number of frames into an offscreen framebuffer
+struct Options
+{
+    bool headless = false;
+    // 0 renders 100 frames, or the whole camera path when replaying
+    int frames = 0;
+    int width = SCREEN_WIDTH;
+    int height = SCREEN_HEIGHT;
+    // PPM image of the last frame, headless only
+    std::string dumpPath;
+    // CSV of the GPU time of every pass in every frame
+    std::string gpuCsvPath;
+    // Chrome trace of the CPU and GPU scopes, written at exit
+    std::string tracePath;
+    // camera path recorded from the input, or replayed at a fixed timestep instead of the input
+    std::string recordPath;
+    std::string replayPath;
+    float replayStep = 1.0f / 60.0f;
+    // frame statistics over the frame, and as a log line every few seconds (0 for none)
+    bool showStats = false;
+    double statsLogInterval = 0.0;
+    // debug context with KHR_debug labels, groups and the driver messages
+    bool glDebug = false;
+};
+
+void printUsage()
+{
+    std::cout << "usage: OpenGL_VSM [--headless] [--frames N] [--size WIDTHxHEIGHT] [--dump IMAGE.ppm] [--gpu-csv TIMES.csv] [--trace TRACE.json]" << std::endl
+        << "    [--record PATH.cam] [--replay PATH.cam] [--replay-step SECONDS] [--stats] [--stats-log SECONDS] [--gl-debug]" << std::endl;
+}
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--headless")
+            options.headless = true;
+        else if (argument == "--frames" && hasValue)
+            options.frames = std::atoi(argv[++i]);
+        else if (argument == "--size" && hasValue && std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) == 2)
+            continue;
+        else if (argument == "--dump" && hasValue)
+            options.dumpPath = argv[++i];
+        else if (argument == "--gpu-csv" && hasValue)
+            options.gpuCsvPath = argv[++i];
+        else if (argument == "--trace" && hasValue)
+            options.tracePath = argv[++i];
+        else if (argument == "--record" && hasValue)
+            options.recordPath = argv[++i];
+        else if (argument == "--replay" && hasValue)
+            options.replayPath = argv[++i];
+        else if (argument == "--replay-step" && hasValue)
+            options.replayStep = (float)std::atof(argv[++i]);
+        else if (argument == "--stats")
+            options.showStats = true;
+        else if (argument == "--stats-log" && hasValue)
+            options.statsLogInterval = std::atof(argv[++i]);
+        else if (argument == "--gl-debug")
+            options.glDebug = true;
+        else
+            return false;
+    }
+    return options.frames >= 0 && options.width > 0 && options.height > 0 && options.replayStep > 0.0f && options.statsLogInterval >= 0.0;
+}
+
+// the camera path to replay, false if one was asked for and could not be read
+bool loadReplay(const Options& options, CameraPath& path)
+{
+    if (options.replayPath.empty())
+        return true;
+    if (!path.load(options.replayPath))
+        return false;
+    std::cout << "replay: " << path.Poses.size() << " poses, " << path.duration() << " s in " << path.frameCount(options.replayStep)
+        << " frames of " << options.replayStep << " s" << std::endl;
+    return true;
+}
+
+#ifdef VSM_HEADLESS
+int runHeadless(const Options& options)
+{
+    CameraPath replay;
+    if (!loadReplay(options, replay))
+        return -1;
+    CameraPath recording;
+    int frames = options.frames;
+    if (frames == 0)
+        frames = replay.Poses.empty() ? 100 : replay.frameCount(options.replayStep);
 
-// light setting
-glm::vec3 lightPosition = glm::vec3(8.0f, 4.0f, 5.0f);
-glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-float lightNearPlane = 0.1f;
-float lightFarPlane = 20.0f;
+    EglContext context;
+    if (!context.create(3, 3, options.glDebug))
+    {
+        std::cout << "Failed to create EGL context" << std::endl;
+        return -1;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)EglContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        context.destroy();
+        return -1;
+    }
+    std::cout << "headless: " << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION) << std::endl;
+
+    // the frame is rendered into an offscreen framebuffer of the requested size
+    OffscreenTarget target;
+    if (!target.create(options.width, options.height))
+    {
+        context.destroy();
+        return -1;
+    }
+
+    RendererSettings settings;
+    settings.width = options.width;
+    settings.height = options.height;
+    settings.outputFramebuffer = target.Framebuffer;
+    settings.debugOutput = options.glDebug;
+    if (!renderer.init(settings))
+    {
+        context.destroy();
+        return -1;
+    }
+    if (!options.gpuCsvPath.empty())
+        renderer.profiler().writeCsv(options.gpuCsvPath);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        CpuTrace::Scope trace("frame");
+        // without a window the frames follow the fixed timestep
+        if (!replay.Poses.empty())
+            replay.apply(renderer.MainCamera, frame, options.replayStep);
+        if (!options.recordPath.empty())
+            recording.record(renderer.MainCamera, frame * options.replayStep);
+        renderer.render();
+    }
+    glFinish();
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "headless: " << frames << " frames at " << options.width << "x" << options.height << " in " << milliseconds
+        << " ms, " << milliseconds / frames << " ms per frame" << std::endl;
+
+    int result = 0;
+    if (!options.recordPath.empty() && !recording.save(options.recordPath))
+        result = -1;
+    if (!options.dumpPath.empty() && !RgbImage::fromBottomUp(options.width, options.height, renderer.readPixels()).save(options.dumpPath))
+        result = -1;
+    // the GPU scopes still in flight reach the trace during shutdown
+    renderer.shutdown();
+    if (!options.tracePath.empty())
+        CpuTrace::global().writeChromeTrace(options.tracePath);
+    context.destroy();
+    return result;
+}
+#endif
 
-int main()
+#ifdef VSM_WINDOW
+int runWindow(const Options& options)
 {
+    CameraPath replay;
+    if (!loadReplay(options, replay))
+        return -1;
+    CameraPath recording;
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (options.glDebug)
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -66,6 +234,7 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -74,158 +243,104 @@ int main()
         return -1;
     }
 
-    glEnable(GL_DEPTH_TEST);
-
-    Shader depthShader("depthShader.vert", "depthShader.frag");
-    Shader averageShader("screenQuad.vert", "varianceCalculate.frag");
-    Shader mainShader("mainShader.vert", "mainShader.frag");
-    Shader debugShader("screenQuad.vert", "debugShader.frag");
-
-    // frame buffer for the first pass, view from the light and get the depth and squared depth
-    unsigned int depthFBO;
-    unsigned int depthRBO;
-    glGenFramebuffers(1, &depthFBO);
-    glGenRenderbuffers(1, &depthRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, DEPTH_MAP_WIDTH, DEPTH_MAP_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
-    glEnable(GL_DEPTH_TEST);
-
-    GLfloat borderColor[] = {1.0, 1.0, 1.0, 1.0};
-
-    unsigned int depthTexture;
-    glGenTextures(1, &depthTexture);
-    glBindTexture(GL_TEXTURE_2D, depthTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, DEPTH_MAP_WIDTH, DEPTH_MAP_HEIGHT, 0, GL_RG, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthTexture, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    unsigned int varianceFBO[2];
-    unsigned int varianceTexture[2];
-    glGenFramebuffers(2, varianceFBO);
-    glGenTextures(2, varianceTexture);
-    
-    for (int i = 0; i < 2; i++)
+    RendererSettings settings;
+    settings.width = SCREEN_WIDTH;
+    settings.height = SCREEN_HEIGHT;
+    settings.debugOutput = options.glDebug;
+    if (!renderer.init(settings))
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, varianceFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, varianceTexture[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, DEPTH_MAP_WIDTH, DEPTH_MAP_HEIGHT, 0, GL_RG, GL_FLOAT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, varianceTexture[i], 0);
+        glfwTerminate();
+        return -1;
     }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    glm::mat4 lightView = glm::lookAt(lightPosition, glm::vec3(6.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 lightProjection = glm::perspective(glm::radians(90.0f), (float)DEPTH_MAP_WIDTH / (float)DEPTH_MAP_HEIGHT, lightNearPlane, lightFarPlane);
-
-    // static parameter of shader
-    depthShader.use();
-    depthShader.setFloat("nearPlane", lightNearPlane);
-    depthShader.setFloat("farPlane", lightFarPlane);
-    mainShader.setInt("varianceShadowMap", 0);
-
-    mainShader.use();
-    mainShader.setFloat("nearPlane", lightNearPlane);
-    mainShader.setFloat("farPlane", lightFarPlane);
-    mainShader.setInt("varianceShadowMap", 0);
-    mainShader.setMat4("worldToLight", lightProjection*lightView);
-    mainShader.setVec3("mainLight.position", lightPosition);
-    mainShader.setVec3("mainLight.intensity", glm::vec3(2,2,2));
-    mainShader.setFloat("mainLight.constant", 1.0);
-    mainShader.setFloat("mainLight.linear", 0.2);
-    mainShader.setFloat("mainLight.quadratic", 0.005);
-    mainShader.setVec3("material.albedo", glm::vec3(0.6, 0.6, 0.6));
-
-    debugShader.use();
-    debugShader.setInt("debugTexture", 0);
-
-    averageShader.use();
-    averageShader.setInt("depthTexture", 0);
-
-    while (!glfwWindowShouldClose(window))
+    if (!options.gpuCsvPath.empty())
+        renderer.profiler().writeCsv(options.gpuCsvPath);
+
+    // replays run a fixed number of frames, a recording starts with the first frame
+    int frames = options.frames;
+    if (frames == 0 && !replay.Poses.empty())
+        frames = replay.frameCount(options.replayStep);
+    float recordingStart = glfwGetTime();
+    for (int frame = 0; !glfwWindowShouldClose(window) && (frames == 0 || frame < frames); frame++)
     {
         // calculate the passed time from last frame
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
-
-        // get camera parameters
-        glm::mat4 view = mainCamera.GetViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(mainCamera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, nearPlane, farPlane);
-
-        // shadow pass
-        glViewport(0, 0, DEPTH_MAP_WIDTH, DEPTH_MAP_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        depthShader.use();
-        depthShader.setMat4("view", lightView);
-        depthShader.setMat4("projection", lightProjection);
-        renderScene(depthShader);
-
-        // calculate the average value
-        glBindFramebuffer(GL_FRAMEBUFFER, varianceFBO[0]);
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, depthTexture);
-        averageShader.use();
-        averageShader.setBool("horizontal", true);
-        renderQuad();
-        glBindFramebuffer(GL_FRAMEBUFFER, varianceFBO[1]);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, varianceTexture[0]);
-        averageShader.setBool("horizontal", false);
-        renderQuad();
-
-        // render from camera view
-        glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, varianceTexture[1]);
-        mainShader.use();
-        mainShader.setMat4("view", view);
-        mainShader.setMat4("projection", projection);
-        mainShader.setVec3("cameraPosition", mainCamera.Position);
-        renderScene(mainShader);
-
-        // debug
-        /*glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        debugShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, varianceTexture[1]);
-        renderQuad();*/
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        CpuTrace::Scope frameTrace("frame");
+        {
+            CpuTrace::Scope trace("input");
+            processInput(window);
+        }
+        // the replayed pose overrides the input, the frame time does not matter
+        if (!replay.Poses.empty())
+            replay.apply(renderer.MainCamera, frame, options.replayStep);
+        if (!options.recordPath.empty())
+            recording.record(renderer.MainCamera, (float)glfwGetTime() - recordingStart);
+        renderer.render();
+
+        {
+            CpuTrace::Scope trace("swap");
+            GpuProfiler::Scope swap(renderer.profiler(), "swap");
+            glfwSwapBuffers(window);
+        }
+        {
+            CpuTrace::Scope trace("poll events");
+            glfwPollEvents();
+        }
     }
 
+    renderer.shutdown();
+    if (!options.tracePath.empty())
+        CpuTrace::global().writeChromeTrace(options.tracePath);
+    if (!options.recordPath.empty())
+        recording.save(options.recordPath);
     glfwTerminate();
 
     return 0;
 }
+#endif
 
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return -1;
+    }
+    if (!options.tracePath.empty())
+    {
+        CpuTrace::global().setThreadName("main");
+        CpuTrace::global().setEnabled(true);
+        traceOutputPath = options.tracePath;
+    }
+    renderer.ShowStatsOverlay = options.showStats;
+    FrameStats::current().LogInterval = options.statsLogInterval;
+#ifndef VSM_WINDOW
+    // built without GLFW, there is no window to open
+    options.headless = true;
+#endif
+    if (options.headless)
+    {
+#ifdef VSM_HEADLESS
+        return runHeadless(options);
+#else
+        std::cout << "Headless mode needs EGL, this build has none" << std::endl;
+        return -1;
+#endif
+    }
+#ifdef VSM_WINDOW
+    return runWindow(options);
+#else
+    return -1;
+#endif
+}
+
+#ifdef VSM_WINDOW
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::current().viewport(0, 0, width, height);
 }
 void mouse_callback(GLFWwindow *window, double xPos, double yPos)
 {
@@ -242,11 +357,21 @@ void mouse_callback(GLFWwindow *window, double xPos, double yPos)
     lastX = xPos;
     lastY = yPos;
 
-    mainCamera.ProcessMouseMovement(xoffset, yoffset);
+    renderer.MainCamera.ProcessMouseMovement(xoffset, yoffset);
 }
 void scroll_callback(GLFWwindow *window, double xOffset, double yOffset)
 {
-    mainCamera.ProcessMouseScroll(yOffset);
+    renderer.MainCamera.ProcessMouseScroll(yOffset);
+}
+// P prints the GPU time of the passes, T writes the trace recorded so far when tracing
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        renderer.profiler().print();
+    if (key == GLFW_KEY_T && action == GLFW_PRESS && !traceOutputPath.empty())
+        CpuTrace::global().writeChromeTrace(traceOutputPath);
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+        renderer.ShowStatsOverlay = !renderer.ShowStatsOverlay;
 }
 void processInput(GLFWwindow *window)
 {
@@ -257,148 +382,19 @@ void processInput(GLFWwindow *window)
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
     {
-        mainCamera.ProcessKeyboard(FORWARD, deltaTime);
+        renderer.MainCamera.ProcessKeyboard(FORWARD, deltaTime);
     }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
     {
-        mainCamera.ProcessKeyboard(BACKWARD, deltaTime);
+        renderer.MainCamera.ProcessKeyboard(BACKWARD, deltaTime);
     }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
     {
-        mainCamera.ProcessKeyboard(LEFT, deltaTime);
+        renderer.MainCamera.ProcessKeyboard(LEFT, deltaTime);
     }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
     {
-        mainCamera.ProcessKeyboard(RIGHT, deltaTime);
+        renderer.MainCamera.ProcessKeyboard(RIGHT, deltaTime);
     }
 }
-
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
-void renderQuad()
-{
-    if (quadVAO == 0)
-    {
-        float quadVertices[] = {
-            // position        // uv
-            -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-            1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-            1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-        };
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
-}
-
-unsigned int frameVAO = 0;
-unsigned int frameVBO;
-unsigned int planeVAO = 0;
-unsigned int planeVBO;
-void renderScene(Shader& shader)
-{
-    if (frameVAO == 0)
-    {
-        float frameVertices[] = {
-            // position         // uv       // normal
-            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f,
-            0.0f, 0.0f, 0.25f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f,
-            0.25f, 0.0f, 0.25f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f,
-            0.25f, 0.0f, 0.25f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f,
-            0.25f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f,
-            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f,
-
-            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-            0.0f, 2.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f,
-            0.0f, 2.0f, 0.25f, 1.0f, 1.0f, -1.0f, 0.0f, 0.0f,
-            0.0f, 2.0f, 0.25f, 1.0f, 1.0f, -1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 0.25f, 1.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-
-            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f,
-            0.25f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f,
-            0.25f, 2.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f,
-            0.25f, 2.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f,
-            0.0f, 2.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f,
-            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f,
-
-            0.0f, 0.0f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-            0.25f, 0.0f, 0.25f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            0.0f, 2.0f, 0.25f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-            0.0f, 0.0f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-
-            0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-            0.25f, 2.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-            0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-            0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-            0.25f, 0.0f, 0.25f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-            0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-
-            0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-            0.0f, 2.0f, 0.25f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            0.25f, 2.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-            0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        };
-        float planeVertices[] = {
-            -100.0f, 0.0f, -100.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-            100.0f, 0.0f, 100.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            -100.0f, 0.0f, 100.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            -100.0f, 0.0f, -100.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-            100.0f, 0.0f, -100.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-            100.0f, 0.0f, 100.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            
-        };
-        glGenVertexArrays(1, &frameVAO);
-        glGenBuffers(1, &frameVBO);
-        glBindVertexArray(frameVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, frameVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(frameVertices), &frameVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(5*sizeof(float)));
-
-        glGenVertexArrays(1, &planeVAO);
-        glGenBuffers(1, &planeVBO);
-        glBindVertexArray(planeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(5*sizeof(float)));
-    }
-    glBindVertexArray(frameVAO);
-    shader.setFloat("material.spec", 64.0);
-    glm::mat4 model = glm::mat4(1.0);
-    for (int i=0; i<5; i++){
-        shader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        model = glm::translate(model, glm::vec3(2.0, 0.0, 0.0));
-    }
-    shader.setFloat("material.spec", 12.0);
-    glBindVertexArray(planeVAO);
-    model = glm::mat4(1.0);
-    model = glm::translate(model, glm::vec3(0.0, 0.001, 0.0));
-    shader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-}
\ No newline at end of file
+#endif
@@ -0,0 +1,394 @@
+#include <glad/glad.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/egl_context.h"
+#include "myOpenGL/offscreen_target.h"
+#include "myOpenGL/camera_path.h"
+#include "myOpenGL/cpu_trace.h"
+#include "vsm_renderer.h"
+
+// Renders the demo headless over a grid of shadow settings and writes the per-pass timings to JSON.
+// Every configuration gets a fresh context and renderer, so nothing is shared between measurements.
+
+// command line options, every axis of the grid is a comma separated list
+struct BenchOptions
+{
+    int warmupFrames = 10;
+    int frames = 100;
+    int width = 1280;
+    int height = 720;
+    std::string outputPath = "OpenGL_VSM_bench.json";
+    std::vector<int> resolutions = {512, 1024, 2048};
+    std::vector<std::string> formats = {"rg32f", "rg16f"};
+    std::vector<int> blurRadii = {2, 4, 8};
+    std::vector<std::string> blurs = {"box", "linear"};
+    std::vector<int> pillarCounts = {5, 100};
+    // camera path flown by every configuration, looped; the default camera stands still without one
+    std::string replayPath;
+    float replayStep = 1.0f / 60.0f;
+    CameraPath replay;
+};
+
+struct BenchConfig
+{
+    int resolution;
+    std::string format;
+    int blurRadius;
+    std::string blur;
+    int pillarCount;
+};
+
+// mean, median and tail of a series of milliseconds
+struct Summary
+{
+    double mean = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+// CPU time of each pass and GPU time from timestamp queries around it, one series per pass
+struct PassTimings
+{
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+};
+
+void printUsage()
+{
+    std::cout << "usage: OpenGL_VSM_bench [--warmup N] [--frames N] [--size WIDTHxHEIGHT] [--output RESULTS.json]" << std::endl
+        << "    [--resolution 512,1024,...] [--format rg32f,rg16f] [--radius 2,4,...] [--blur box,linear] [--pillars 5,100,...]" << std::endl
+        << "    [--replay PATH.cam] [--replay-step SECONDS]" << std::endl;
+}
+
+template <typename T>
+bool parseList(const std::string& text, std::vector<T>& values)
+{
+    values.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        std::stringstream itemStream(item);
+        T value;
+        if (!(itemStream >> value))
+            return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        std::string value = argv[++i];
+        bool valid = true;
+        if (argument == "--warmup")
+            options.warmupFrames = std::atoi(value.c_str());
+        else if (argument == "--frames")
+            options.frames = std::atoi(value.c_str());
+        else if (argument == "--size")
+            valid = std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) == 2;
+        else if (argument == "--output")
+            options.outputPath = value;
+        else if (argument == "--resolution")
+            valid = parseList(value, options.resolutions);
+        else if (argument == "--format")
+            valid = parseList(value, options.formats);
+        else if (argument == "--radius")
+            valid = parseList(value, options.blurRadii);
+        else if (argument == "--blur")
+            valid = parseList(value, options.blurs);
+        else if (argument == "--pillars")
+            valid = parseList(value, options.pillarCounts);
+        else if (argument == "--replay")
+            options.replayPath = value;
+        else if (argument == "--replay-step")
+            options.replayStep = (float)std::atof(value.c_str());
+        else
+            valid = false;
+        if (!valid)
+            return false;
+    }
+    for (const std::string& format : options.formats)
+        if (format != "rg32f" && format != "rg16f")
+            return false;
+    for (const std::string& blur : options.blurs)
+        if (blur != "box" && blur != "linear")
+            return false;
+    return options.warmupFrames >= 0 && options.frames > 0 && options.width > 0 && options.height > 0 && options.replayStep > 0.0f;
+}
+
+// linear interpolation between the closest ranks of the sorted samples
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+    double position = fraction * (sorted.size() - 1);
+    size_t lower = (size_t)std::floor(position);
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (position - lower);
+}
+Summary summarize(std::vector<double> samples)
+{
+    Summary summary;
+    if (samples.empty())
+        return summary;
+    std::sort(samples.begin(), samples.end());
+    for (double sample : samples)
+        summary.mean += sample;
+    summary.mean /= samples.size();
+    summary.median = percentile(samples, 0.5);
+    summary.p95 = percentile(samples, 0.95);
+    summary.p99 = percentile(samples, 0.99);
+    return summary;
+}
+
+void writeSummary(std::ostream& out, const char* name, const std::vector<double>& samples)
+{
+    Summary summary = summarize(samples);
+    out << "\"" << name << "\": {\"mean\": " << summary.mean << ", \"median\": " << summary.median
+        << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << "}";
+}
+void writeTimings(std::ostream& out, const PassTimings& timings)
+{
+    out << "{";
+    writeSummary(out, "cpu_ms", timings.cpu);
+    out << ", ";
+    writeSummary(out, "gpu_ms", timings.gpu);
+    out << "}";
+}
+
+// Timestamp queries around every pass and the whole frame. The results are read right after the frame, which
+// waits for the GPU; the bench measures the passes, not how well the frames overlap.
+class FrameTimer
+{
+public:
+    // passes in the order they first executed
+    std::vector<std::string> PassNames;
+    std::map<std::string, PassTimings> Passes;
+    PassTimings Frame;
+    bool Recording = false;
+
+    ~FrameTimer()
+    {
+        if (!queries.empty())
+            glDeleteQueries((GLsizei)queries.size(), queries.data());
+    }
+
+    void beginFrame()
+    {
+        frameStart = std::chrono::steady_clock::now();
+        marks.clear();
+        nextQuery = 0;
+        frameQueries[0] = timestamp();
+    }
+    void beginPass(const std::string& name)
+    {
+        marks.push_back(Mark{name, std::chrono::steady_clock::now(), timestamp(), 0, 0.0});
+    }
+    void endPass()
+    {
+        Mark& mark = marks.back();
+        mark.cpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mark.cpuStart).count();
+        mark.endQuery = timestamp();
+    }
+    void endFrame()
+    {
+        double frameCpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        frameQueries[1] = timestamp();
+        if (!Recording)
+            return;
+        for (const Mark& mark : marks)
+        {
+            if (Passes.find(mark.name) == Passes.end())
+                PassNames.push_back(mark.name);
+            PassTimings& timings = Passes[mark.name];
+            timings.cpu.push_back(mark.cpu);
+            timings.gpu.push_back(elapsed(mark.beginQuery, mark.endQuery));
+        }
+        Frame.cpu.push_back(frameCpu);
+        Frame.gpu.push_back(elapsed(frameQueries[0], frameQueries[1]));
+    }
+
+private:
+    struct Mark
+    {
+        std::string name;
+        std::chrono::steady_clock::time_point cpuStart;
+        GLuint beginQuery;
+        GLuint endQuery;
+        double cpu;
+    };
+    std::vector<GLuint> queries;
+    size_t nextQuery = 0;
+    std::vector<Mark> marks;
+    GLuint frameQueries[2] = {};
+    std::chrono::steady_clock::time_point frameStart;
+
+    // the queries of the last frame are read before they are reused
+    GLuint timestamp()
+    {
+        if (nextQuery == queries.size())
+        {
+            GLuint query;
+            glGenQueries(1, &query);
+            queries.push_back(query);
+        }
+        GLuint query = queries[nextQuery++];
+        glQueryCounter(query, GL_TIMESTAMP);
+        return query;
+    }
+    static double elapsed(GLuint begin, GLuint end)
+    {
+        GLuint64 beginTime = 0, endTime = 0;
+        glGetQueryObjectui64v(begin, GL_QUERY_RESULT, &beginTime);
+        glGetQueryObjectui64v(end, GL_QUERY_RESULT, &endTime);
+        return (endTime - beginTime) / 1.0e6;
+    }
+};
+
+// renders one configuration in its own context, false if it could not run
+bool runConfig(const BenchOptions& options, const BenchConfig& config, std::ostream& out)
+{
+    EglContext context;
+    if (!context.create(3, 3))
+        return false;
+    if (!gladLoadGLLoader((GLADloadproc)EglContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        context.destroy();
+        return false;
+    }
+    // the tracked state belongs to the previous context
+    GLState::current().invalidate();
+    GLState::current().resetCounters();
+
+    OffscreenTarget target;
+    if (!target.create(options.width, options.height))
+    {
+        context.destroy();
+        return false;
+    }
+
+    bool result = false;
+    {
+        VsmRenderer renderer;
+        RendererSettings settings;
+        settings.width = options.width;
+        settings.height = options.height;
+        settings.outputFramebuffer = target.Framebuffer;
+        settings.depthMapWidth = config.resolution;
+        settings.depthMapHeight = config.resolution;
+        settings.momentsFormat = config.format == "rg16f" ? GL_RG16F : GL_RG32F;
+        settings.blurRadius = config.blurRadius;
+        settings.linearBlurTaps = config.blur == "linear";
+        settings.pillarCount = config.pillarCount;
+        // the bench reads its own queries back every frame
+        settings.profileGpu = false;
+        settings.printStatistics = false;
+        if (renderer.init(settings))
+        {
+            FrameTimer timer;
+            renderer.graph().BeginPass = [&timer](const std::string& name) { timer.beginPass(name); };
+            renderer.graph().EndPass = [&timer](const std::string&) { timer.endPass(); };
+            for (int frame = 0; frame < options.warmupFrames + options.frames; frame++)
+            {
+                timer.Recording = frame >= options.warmupFrames;
+                if (!options.replay.Poses.empty())
+                    options.replay.apply(renderer.MainCamera, frame % options.replay.frameCount(options.replayStep), options.replayStep);
+                timer.beginFrame();
+                renderer.render();
+                timer.endFrame();
+            }
+            renderer.shutdown();
+
+            out << "    {\"resolution\": " << config.resolution << ", \"format\": \"" << config.format << "\", \"blur_radius\": "
+                << config.blurRadius << ", \"blur\": \"" << config.blur << "\", \"pillars\": " << config.pillarCount << "," << std::endl;
+            out << "      \"passes\": {" << std::endl;
+            for (size_t i = 0; i < timer.PassNames.size(); i++)
+            {
+                out << "        \"" << timer.PassNames[i] << "\": ";
+                writeTimings(out, timer.Passes[timer.PassNames[i]]);
+                out << (i + 1 < timer.PassNames.size() ? "," : "") << std::endl;
+            }
+            out << "      }," << std::endl << "      \"frame\": ";
+            writeTimings(out, timer.Frame);
+            out << std::endl << "    }";
+
+            Summary frame = summarize(timer.Frame.gpu);
+            std::cout << "bench: " << config.resolution << " " << config.format << " radius " << config.blurRadius << " " << config.blur
+                << " " << config.pillarCount << " pillars: " << frame.median << " ms GPU median, " << frame.p99 << " ms p99" << std::endl;
+            result = true;
+        }
+    }
+    target.destroy();
+    context.destroy();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return -1;
+    }
+    if (!options.replayPath.empty() && !options.replay.load(options.replayPath))
+        return -1;
+
+    std::vector<BenchConfig> configs;
+    for (int resolution : options.resolutions)
+        for (const std::string& format : options.formats)
+            for (int blurRadius : options.blurRadii)
+                for (const std::string& blur : options.blurs)
+                    for (int pillarCount : options.pillarCounts)
+                        configs.push_back(BenchConfig{resolution, format, blurRadius, blur, pillarCount});
+
+    // written next to the output and renamed once complete, a failed run leaves no truncated JSON behind
+    std::string partialPath = options.outputPath + ".partial";
+    std::ofstream file(partialPath);
+    if (!file)
+    {
+        std::cout << "ERROR::BENCH::FILE_NOT_WRITTEN: " << options.outputPath << std::endl;
+        return -1;
+    }
+    file << "{" << std::endl << "  \"replay\": \"" << CpuTrace::escape(options.replayPath.c_str()) << "\", \"width\": " << options.width << ", \"height\": " << options.height << ", \"warmup_frames\": "
+        << options.warmupFrames << ", \"frames\": " << options.frames << "," << std::endl << "  \"results\": [" << std::endl;
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        if (!runConfig(options, configs[i], file))
+        {
+            std::cout << "ERROR::BENCH::CONFIGURATION_FAILED" << std::endl;
+            file.close();
+            std::remove(partialPath.c_str());
+            return -1;
+        }
+        file << (i + 1 < configs.size() ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl << "}" << std::endl;
+    file.close();
+    if (!file || std::rename(partialPath.c_str(), options.outputPath.c_str()) != 0)
+    {
+        std::cout << "ERROR::BENCH::FILE_NOT_WRITTEN: " << options.outputPath << std::endl;
+        std::remove(partialPath.c_str());
+        return -1;
+    }
+    std::cout << "bench: " << configs.size() << " configurations written to " << options.outputPath << std::endl;
+    return 0;
+}
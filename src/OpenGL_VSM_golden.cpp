@@ -0,0 +1,205 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/egl_context.h"
+#include "myOpenGL/offscreen_target.h"
+#include "myOpenGL/image.h"
+#include "vsm_renderer.h"
+
+// Renders fixed camera poses headless in every shadow mode and compares them with the golden images by SSIM.
+// A mode that only changes how the image is made (draw paths, storage precision, blur implementation) is compared
+// with the reference golden, its tolerance is the quality it may lose; a mode that changes the image on purpose
+// has a golden of its own. Failures write the rendered image and an SSIM heatmap. Exits with 1 on any failure.
+
+#ifndef VSM_GOLDEN_DIR
+#define VSM_GOLDEN_DIR "golden"
+#endif
+
+// goldens are stored at this size
+const int IMAGE_WIDTH = 256;
+const int IMAGE_HEIGHT = 144;
+
+struct GoldenCase
+{
+    const char* name;
+    // golden the case is compared with
+    const char* golden;
+    // lowest mean SSIM that passes
+    double minimumSimilarity;
+    void (*configure)(RendererSettings& settings);
+};
+
+const GoldenCase CASES[] = {
+    {"reference", "reference", 0.9999, [](RendererSettings&) {}},
+    {"instanced", "reference", 0.9999, [](RendererSettings& settings) { settings.useMultiDraw = false; }},
+    {"plain", "reference", 0.9999, [](RendererSettings& settings) { settings.useMultiDraw = false; settings.useInstancing = false; settings.usePackedVertices = false; }},
+    {"unpacked", "reference", 0.9999, [](RendererSettings& settings) { settings.usePackedVertices = false; }},
+    {"rg16f", "reference", 0.99, [](RendererSettings& settings) { settings.momentsFormat = GL_RG16F; }},
+    {"linear_blur", "reference", 0.995, [](RendererSettings& settings) { settings.linearBlurTaps = true; }},
+    {"linear_blur_odd", "radius_3", 0.995, [](RendererSettings& settings) { settings.blurRadius = 3; settings.linearBlurTaps = true; }},
+    {"radius_3", "radius_3", 0.9999, [](RendererSettings& settings) { settings.blurRadius = 3; }},
+    {"shadow_512", "reference", 0.99, [](RendererSettings& settings) { settings.depthMapWidth = 512; settings.depthMapHeight = 512; }},
+    {"variance_map", "variance_map", 0.9999, [](RendererSettings& settings) { settings.showVarianceMap = true; }},
+};
+
+struct GoldenPose
+{
+    const char* name;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+const GoldenPose POSES[] = {
+    {"start", glm::vec3(0.0f, 2.0f, 8.0f), -90.0f, 0.0f},
+    {"overview", glm::vec3(4.0f, 6.0f, 9.0f), -95.0f, -35.0f},
+};
+
+struct GoldenOptions
+{
+    bool update = false;
+    std::string goldenDirectory = VSM_GOLDEN_DIR;
+    std::string outputDirectory = ".";
+    std::string only;
+};
+
+void printUsage()
+{
+    std::cout << "usage: OpenGL_VSM_golden [--update] [--golden DIRECTORY] [--output DIRECTORY] [--case NAME]" << std::endl
+        << "    --update writes the goldens of the cases that own one instead of comparing" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, GoldenOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--update")
+            options.update = true;
+        else if (argument == "--golden" && hasValue)
+            options.goldenDirectory = argv[++i];
+        else if (argument == "--output" && hasValue)
+            options.outputDirectory = argv[++i];
+        else if (argument == "--case" && hasValue)
+            options.only = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+
+// renders every pose of a case in a context of its own
+bool renderCase(const GoldenCase& goldenCase, std::vector<RgbImage>& images)
+{
+    EglContext context;
+    if (!context.create(3, 3))
+        return false;
+    if (!gladLoadGLLoader((GLADloadproc)EglContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        context.destroy();
+        return false;
+    }
+    GLState::current().invalidate();
+
+    OffscreenTarget target;
+    if (!target.create(IMAGE_WIDTH, IMAGE_HEIGHT))
+    {
+        context.destroy();
+        return false;
+    }
+
+    bool result = false;
+    {
+        VsmRenderer renderer;
+        RendererSettings settings;
+        settings.width = IMAGE_WIDTH;
+        settings.height = IMAGE_HEIGHT;
+        settings.outputFramebuffer = target.Framebuffer;
+        settings.profileGpu = false;
+        settings.printStatistics = false;
+        goldenCase.configure(settings);
+        if (renderer.init(settings))
+        {
+            for (const GoldenPose& pose : POSES)
+            {
+                renderer.MainCamera.SetPose(pose.position, pose.yaw, pose.pitch, 45.0f);
+                renderer.render();
+                images.push_back(RgbImage::fromBottomUp(IMAGE_WIDTH, IMAGE_HEIGHT, renderer.readPixels()));
+            }
+            renderer.shutdown();
+            result = true;
+        }
+    }
+    target.destroy();
+    context.destroy();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    GoldenOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return -1;
+    }
+
+    int failures = 0;
+    int compared = 0;
+    for (const GoldenCase& goldenCase : CASES)
+    {
+        if (!options.only.empty() && options.only != goldenCase.name)
+            continue;
+        bool ownsGolden = std::string(goldenCase.name) == goldenCase.golden;
+        if (options.update && !ownsGolden)
+            continue;
+
+        std::vector<RgbImage> images;
+        if (!renderCase(goldenCase, images))
+        {
+            std::cout << "ERROR::GOLDEN::RENDER_FAILED: " << goldenCase.name << std::endl;
+            return -1;
+        }
+
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            std::string suffix = std::string("_") + POSES[i].name + ".ppm";
+            std::string goldenPath = options.goldenDirectory + "/" + goldenCase.golden + suffix;
+            if (options.update)
+            {
+                if (!images[i].save(goldenPath))
+                    return -1;
+                std::cout << "golden: wrote " << goldenPath << std::endl;
+                continue;
+            }
+
+            RgbImage golden;
+            std::vector<float> map;
+            double similarity = golden.load(goldenPath) ? structuralSimilarity(golden, images[i], &map) : -1.0;
+            bool passed = similarity >= goldenCase.minimumSimilarity;
+            compared++;
+            std::cout << (passed ? "pass " : "FAIL ") << std::left << std::setw(16) << goldenCase.name << std::setw(10) << POSES[i].name
+                << std::right << " ssim " << std::fixed << std::setprecision(5) << similarity << " (min " << goldenCase.minimumSimilarity << ")"
+                << std::defaultfloat << std::endl;
+            if (passed)
+                continue;
+            failures++;
+            std::string outputPrefix = options.outputDirectory + "/" + goldenCase.name + "_" + POSES[i].name;
+            images[i].save(outputPrefix + ".ppm");
+            if (!map.empty())
+                similarityHeatmap(map, IMAGE_WIDTH, IMAGE_HEIGHT).save(outputPrefix + "_ssim.ppm");
+        }
+    }
+    if (options.update)
+        return 0;
+    std::cout << "golden: " << compared - failures << " of " << compared << " images passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
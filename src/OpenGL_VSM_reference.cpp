@@ -0,0 +1,245 @@
+#ifdef VSM_HEADLESS
+#include <glad/glad.h>
+#endif
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "cpu_reference.h"
+#include "vsm_scene.h"
+#ifdef VSM_HEADLESS
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/egl_context.h"
+#include "myOpenGL/offscreen_target.h"
+#include "vsm_renderer.h"
+#endif
+
+// Runs the variance shadow map pipeline of the demo scene on the CPU and measures how far approximate shadow modes
+// (half float moments, a smaller map) and, with --gpu, the GPU passes are from it. The error is the visibility
+// difference on a grid over the ground plane; none of this needs a GPU except the --gpu comparison.
+
+// the light of VsmRenderer
+const glm::vec3 LIGHT_POSITION = glm::vec3(8.0f, 4.0f, 5.0f);
+const float LIGHT_NEAR_PLANE = 0.1f;
+const float LIGHT_FAR_PLANE = 20.0f;
+
+// the ground area the visibility is compared over, it holds every pillar shadow of the default scene
+const glm::vec2 GROUND_MIN = glm::vec2(-6.0f, -10.0f);
+const glm::vec2 GROUND_MAX = glm::vec2(12.0f, 4.0f);
+const float GROUND_HEIGHT = 0.001f;
+// a visibility difference above this counts as a visible error
+const float ERROR_THRESHOLD = 0.01f;
+
+struct ReferenceOptions
+{
+    int resolution = 1024;
+    int blurRadius = 4;
+    int threadCount = 0;
+    int pillarCount = 5;
+    // ground samples per axis
+    int samples = 256;
+    bool gpu = false;
+};
+
+// visibility difference between two shadow functions over the ground grid
+struct ShadowError
+{
+    double mean = 0.0;
+    double maximum = 0.0;
+    double aboveThreshold = 0.0;
+};
+
+void printUsage()
+{
+    std::cout << "usage: OpenGL_VSM_reference [--resolution N] [--radius N] [--threads N] [--pillars N] [--samples N] [--gpu]" << std::endl
+        << "    --gpu renders the same scene with the GPU renderer and compares its variance map" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, ReferenceOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--resolution" && hasValue)
+            options.resolution = std::atoi(argv[++i]);
+        else if (argument == "--radius" && hasValue)
+            options.blurRadius = std::atoi(argv[++i]);
+        else if (argument == "--threads" && hasValue)
+            options.threadCount = std::atoi(argv[++i]);
+        else if (argument == "--pillars" && hasValue)
+            options.pillarCount = std::atoi(argv[++i]);
+        else if (argument == "--samples" && hasValue)
+            options.samples = std::atoi(argv[++i]);
+        else if (argument == "--gpu")
+            options.gpu = true;
+        else
+            return false;
+    }
+    return options.resolution > 0 && options.blurRadius >= 0 && options.threadCount >= 0 && options.pillarCount >= 0 && options.samples > 1;
+}
+
+CpuVsmSettings referenceSettings(const ReferenceOptions& options, int resolution)
+{
+    CpuVsmSettings settings;
+    settings.width = resolution;
+    settings.height = resolution;
+    settings.blurRadius = options.blurRadius;
+    settings.nearPlane = LIGHT_NEAR_PLANE;
+    settings.farPlane = LIGHT_FAR_PLANE;
+    settings.lightView = lightViewMatrix(LIGHT_POSITION);
+    settings.lightProjection = lightProjectionMatrix(resolution, resolution, LIGHT_NEAR_PLANE, LIGHT_FAR_PLANE);
+    settings.threadCount = options.threadCount;
+    return settings;
+}
+
+template <typename Shadow>
+ShadowError compareShadows(const CpuVsm& reference, Shadow shadow, int samples)
+{
+    ShadowError error;
+    for (int z = 0; z < samples; z++)
+        for (int x = 0; x < samples; x++)
+        {
+            glm::vec2 ground = glm::mix(GROUND_MIN, GROUND_MAX, glm::vec2(x, z) / float(samples - 1));
+            glm::vec3 position = glm::vec3(ground.x, GROUND_HEIGHT, ground.y);
+            // calculateShadow is not clamped, a negative variance of rounded moments can leave [0, 1]; the
+            // framebuffer clamps it, so does the comparison
+            double difference = std::fabs(glm::clamp(reference.shadow(position), 0.0f, 1.0f) - glm::clamp(shadow(position), 0.0f, 1.0f));
+            error.mean += difference;
+            error.maximum = std::max(error.maximum, difference);
+            error.aboveThreshold += difference > ERROR_THRESHOLD ? 1.0 : 0.0;
+        }
+    error.mean /= double(samples) * samples;
+    error.aboveThreshold /= double(samples) * samples;
+    return error;
+}
+
+void printError(const std::string& name, const ShadowError& error)
+{
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(5)
+        << " mean " << error.mean << "  max " << error.maximum
+        << "  above " << ERROR_THRESHOLD << " " << std::setprecision(2) << error.aboveThreshold * 100.0 << "%"
+        << std::defaultfloat << std::endl;
+}
+
+double renderTimed(CpuVsm& vsm, const std::vector<glm::vec3>& triangles)
+{
+    auto start = std::chrono::steady_clock::now();
+    vsm.render(triangles);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#ifdef VSM_HEADLESS
+// the blurred moments of one frame of the GPU renderer with the same light and map settings
+bool renderGpuVarianceMap(const ReferenceOptions& options, MomentMap& map)
+{
+    EglContext context;
+    if (!context.create(3, 3))
+        return false;
+    if (!gladLoadGLLoader((GLADloadproc)EglContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        context.destroy();
+        return false;
+    }
+    GLState::current().invalidate();
+
+    OffscreenTarget target;
+    if (!target.create(64, 64))
+    {
+        context.destroy();
+        return false;
+    }
+
+    bool result = false;
+    {
+        VsmRenderer renderer;
+        RendererSettings settings;
+        settings.width = target.Width;
+        settings.height = target.Height;
+        settings.outputFramebuffer = target.Framebuffer;
+        settings.depthMapWidth = options.resolution;
+        settings.depthMapHeight = options.resolution;
+        settings.blurRadius = options.blurRadius;
+        settings.pillarCount = options.pillarCount;
+        settings.profileGpu = false;
+        settings.printStatistics = false;
+        renderer.LightPosition = LIGHT_POSITION;
+        renderer.LightNearPlane = LIGHT_NEAR_PLANE;
+        renderer.LightFarPlane = LIGHT_FAR_PLANE;
+        if (renderer.init(settings))
+        {
+            renderer.render();
+            std::vector<float> texels = renderer.readVarianceMap();
+            map.width = options.resolution;
+            map.height = options.resolution;
+            map.texels.resize(texels.size() / 2);
+            for (size_t i = 0; i < map.texels.size(); i++)
+                map.texels[i] = glm::vec2(texels[i * 2], texels[i * 2 + 1]);
+            renderer.shutdown();
+            result = true;
+        }
+    }
+    target.destroy();
+    context.destroy();
+    return result;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    ReferenceOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return -1;
+    }
+
+    std::vector<glm::vec3> triangles = sceneTriangles(options.pillarCount);
+    CpuVsm reference(referenceSettings(options, options.resolution));
+    double milliseconds = renderTimed(reference, triangles);
+    std::cout << "reference: " << triangles.size() / 3 << " triangles into " << options.resolution << "x" << options.resolution
+        << ", radius " << options.blurRadius << ", " << std::fixed << std::setprecision(2) << milliseconds << " ms" << std::defaultfloat << std::endl;
+
+    // approximate modes of the CPU pipeline against the full precision reference
+    CpuVsmSettings halfSettings = referenceSettings(options, options.resolution);
+    halfSettings.halfPrecision = true;
+    CpuVsm half(halfSettings);
+    half.render(triangles);
+    printError("rg16f", compareShadows(reference, [&half](const glm::vec3& p) { return half.shadow(p); }, options.samples));
+
+    if (options.resolution >= 2)
+    {
+        CpuVsm smaller(referenceSettings(options, options.resolution / 2));
+        smaller.render(triangles);
+        printError("half resolution", compareShadows(reference, [&smaller](const glm::vec3& p) { return smaller.shadow(p); }, options.samples));
+    }
+
+    if (!options.gpu)
+        return 0;
+#ifdef VSM_HEADLESS
+    MomentMap gpuMap;
+    if (!renderGpuVarianceMap(options, gpuMap))
+    {
+        std::cout << "ERROR::REFERENCE::GPU_RENDER_FAILED" << std::endl;
+        return -1;
+    }
+    double momentError = 0.0;
+    const MomentMap& cpuMap = reference.varianceMap();
+    for (size_t i = 0; i < cpuMap.texels.size(); i++)
+        momentError = std::max(momentError, (double)std::fabs(cpuMap.texels[i].x - gpuMap.texels[i].x));
+    std::cout << "gpu: largest first moment difference " << momentError << std::endl;
+    printError("gpu", compareShadows(reference, [&reference, &gpuMap](const glm::vec3& p) { return reference.shadow(gpuMap, p); }, options.samples));
+    return 0;
+#else
+    std::cout << "ERROR::REFERENCE::NO_HEADLESS_CONTEXT: built without EGL, --gpu is not available" << std::endl;
+    return -1;
+#endif
+}
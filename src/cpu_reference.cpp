@@ -0,0 +1,332 @@
+#include "cpu_reference.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CPU_REFERENCE_SSE2
+#endif
+
+// the cleared depth buffer, NDC depth of the far plane
+static const float CLEAR_DEPTH = 1.0f;
+// the shadow pass clears its color to white, texels without geometry keep it
+static const glm::vec2 CLEAR_MOMENTS = glm::vec2(1.0f);
+// SHADOW_BIAS of mainShader.frag
+static const float SHADOW_BIAS = 0.001f;
+
+// splits [0, count) into one contiguous range per thread, the calling thread takes the first
+template <typename Function>
+static void parallelFor(int count, int threadCount, Function function)
+{
+    threadCount = std::max(1, std::min(threadCount, count));
+    std::vector<std::thread> workers;
+    for (int thread = 1; thread < threadCount; thread++)
+        workers.emplace_back(function, count * thread / threadCount, count * (thread + 1) / threadCount);
+    function(0, count / threadCount);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+glm::vec2 MomentMap::sample(const glm::vec2& uv) const
+{
+    float x = uv.x * width - 0.5f;
+    float y = uv.y * height - 0.5f;
+    int x0 = (int)std::floor(x);
+    int y0 = (int)std::floor(y);
+    float fx = x - x0;
+    float fy = y - y0;
+    auto texel = [this](int tx, int ty)
+    {
+        if (tx < 0 || ty < 0 || tx >= width || ty >= height)
+            return CLEAR_MOMENTS;
+        return texels[(size_t)ty * width + tx];
+    };
+    glm::vec2 bottom = glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx);
+    glm::vec2 top = glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx);
+    return glm::mix(bottom, top, fy);
+}
+
+CpuVsm::CpuVsm(const CpuVsmSettings& settings) : currentSettings(settings)
+{
+    threadCount = settings.threadCount > 0 ? settings.threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+    momentMap.width = blurredMap.width = settings.width;
+    momentMap.height = blurredMap.height = settings.height;
+}
+
+float CpuVsm::linearizeDepth(float ndcDepth) const
+{
+    float nearPlane = currentSettings.nearPlane;
+    float farPlane = currentSettings.farPlane;
+    float z = (2.0f * nearPlane * farPlane) / (farPlane + nearPlane - ndcDepth * (farPlane - nearPlane));
+    return (z - nearPlane) / (farPlane - nearPlane);
+}
+
+void CpuVsm::render(const std::vector<glm::vec3>& triangles)
+{
+    rasterize(triangles);
+
+    // depthShader.frag: linear depth and its square where a triangle was drawn
+    const int width = currentSettings.width;
+    const int stride = (width + 3) & ~3;
+    momentMap.texels.resize((size_t)width * currentSettings.height);
+    parallelFor(currentSettings.height, threadCount, [&](int rowBegin, int rowEnd)
+    {
+        for (int y = rowBegin; y < rowEnd; y++)
+            for (int x = 0; x < width; x++)
+            {
+                float depth = depthBuffer[(size_t)y * stride + x];
+                glm::vec2& moments = momentMap.texels[(size_t)y * width + x];
+                if (depth >= CLEAR_DEPTH)
+                {
+                    moments = CLEAR_MOMENTS;
+                    continue;
+                }
+                float linear = linearizeDepth(depth);
+                moments = glm::vec2(linear, linear * linear);
+            }
+    });
+    if (currentSettings.halfPrecision)
+        roundToHalf(momentMap);
+
+    MomentMap blurredRows = momentMap;
+    blur(momentMap, blurredRows, true);
+    blurredMap = blurredRows;
+    blur(blurredRows, blurredMap, false);
+}
+
+float CpuVsm::shadow(const glm::vec3& worldPosition) const
+{
+    return shadow(blurredMap, worldPosition);
+}
+
+// calculateShadow of mainShader.frag, the light space position is computed the same way
+float CpuVsm::shadow(const MomentMap& map, const glm::vec3& worldPosition) const
+{
+    glm::vec4 lightSpacePosition = currentSettings.lightProjection * currentSettings.lightView * glm::vec4(worldPosition, 1.0f);
+    lightSpacePosition /= lightSpacePosition.w;
+    float depth = glm::clamp(linearizeDepth(lightSpacePosition.z), 0.0f, 1.0f);
+    glm::vec2 uv = glm::vec2(lightSpacePosition) * 0.5f + 0.5f;
+    glm::vec2 moments = map.sample(uv);
+    float variance = moments.y - moments.x * moments.x;
+    if (depth - SHADOW_BIAS <= moments.x)
+        return 1.0f;
+    return variance / (variance + (depth - moments.x) * (depth - moments.x));
+}
+
+// a clipped triangle in window coordinates, x and y in pixels, z in NDC
+struct ScreenTriangle
+{
+    float x[3];
+    float y[3];
+    float z[3];
+};
+
+// Sutherland-Hodgman against one plane of the clip space, distance(v) >= 0 is kept
+template <typename Distance>
+static std::vector<glm::vec4> clipPolygon(const std::vector<glm::vec4>& polygon, Distance distance)
+{
+    std::vector<glm::vec4> clipped;
+    for (size_t i = 0; i < polygon.size(); i++)
+    {
+        const glm::vec4& a = polygon[i];
+        const glm::vec4& b = polygon[(i + 1) % polygon.size()];
+        float da = distance(a);
+        float db = distance(b);
+        if (da >= 0.0f)
+            clipped.push_back(a);
+        if ((da >= 0.0f) != (db >= 0.0f))
+            clipped.push_back(glm::mix(a, b, da / (da - db)));
+    }
+    return clipped;
+}
+
+// rasterizes one triangle into the rows [rowBegin, rowEnd) of the depth buffer with a LESS depth test
+static void rasterizeTriangle(const ScreenTriangle& triangle, float* depthBuffer, int stride, int width, int rowBegin, int rowEnd)
+{
+    float x0 = triangle.x[0], y0 = triangle.y[0];
+    float x1 = triangle.x[1], y1 = triangle.y[1];
+    float x2 = triangle.x[2], y2 = triangle.y[2];
+    float z0 = triangle.z[0], z1 = triangle.z[1], z2 = triangle.z[2];
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (area == 0.0f)
+        return;
+    // the shadow pass does not cull, clockwise triangles are turned around
+    if (area < 0.0f)
+    {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+        std::swap(z1, z2);
+        area = -area;
+    }
+
+    // edge functions a*x + b*y + c, positive inside; edge i is opposite vertex i
+    const float ax[3] = {x1, x2, x0}, ay[3] = {y1, y2, y0};
+    const float bx[3] = {x2, x0, x1}, by[3] = {y2, y0, y1};
+    float a[3], b[3], c[3];
+    bool topLeft[3];
+    for (int i = 0; i < 3; i++)
+    {
+        a[i] = -(by[i] - ay[i]);
+        b[i] = bx[i] - ax[i];
+        c[i] = -(a[i] * ax[i] + b[i] * ay[i]);
+        // a left edge has the inside to its right, a top edge (y up) has it below
+        topLeft[i] = a[i] > 0.0f || (a[i] == 0.0f && b[i] < 0.0f);
+    }
+    // depth plane from the barycentric weights
+    float za = (a[0] * z0 + a[1] * z1 + a[2] * z2) / area;
+    float zb = (b[0] * z0 + b[1] * z1 + b[2] * z2) / area;
+    float zc = (c[0] * z0 + c[1] * z1 + c[2] * z2) / area;
+
+    int minX = std::max(0, (int)std::floor(std::min(x0, std::min(x1, x2))));
+    int maxX = std::min(width - 1, (int)std::ceil(std::max(x0, std::max(x1, x2))));
+    int minY = std::max(rowBegin, (int)std::floor(std::min(y0, std::min(y1, y2))));
+    int maxY = std::min(rowEnd - 1, (int)std::ceil(std::max(y0, std::max(y1, y2))));
+    if (minX > maxX || minY > maxY)
+        return;
+
+#ifdef CPU_REFERENCE_SSE2
+    const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128i laneIndices = _mm_set_epi32(3, 2, 1, 0);
+    __m128 edgeA[3], edgeB[3], edgeC[3], edgeInclusive[3];
+    for (int i = 0; i < 3; i++)
+    {
+        edgeA[i] = _mm_set1_ps(a[i]);
+        edgeB[i] = _mm_set1_ps(b[i]);
+        edgeC[i] = _mm_set1_ps(c[i]);
+        edgeInclusive[i] = _mm_castsi128_ps(_mm_set1_epi32(topLeft[i] ? -1 : 0));
+    }
+    const __m128 depthA = _mm_set1_ps(za);
+    const __m128 zero = _mm_setzero_ps();
+    // four pixels per step, rows are padded to a multiple of four so the last step stays inside the row
+    for (int y = minY; y <= maxY; y++)
+    {
+        __m128 py = _mm_set1_ps(y + 0.5f);
+        __m128 rowEdge[3];
+        for (int i = 0; i < 3; i++)
+            rowEdge[i] = _mm_add_ps(_mm_mul_ps(edgeB[i], py), edgeC[i]);
+        __m128 rowDepth = _mm_set1_ps(zb * (y + 0.5f) + zc);
+        float* row = depthBuffer + (size_t)y * stride;
+        for (int x = minX & ~3; x <= maxX; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+            __m128i lane = _mm_add_epi32(_mm_set1_epi32(x), laneIndices);
+            __m128 inside = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(lane, _mm_set1_epi32(minX - 1)), _mm_cmplt_epi32(lane, _mm_set1_epi32(maxX + 1))));
+            for (int i = 0; i < 3; i++)
+            {
+                __m128 edge = _mm_add_ps(_mm_mul_ps(edgeA[i], px), rowEdge[i]);
+                __m128 covered = _mm_or_ps(_mm_cmpgt_ps(edge, zero), _mm_and_ps(edgeInclusive[i], _mm_cmpeq_ps(edge, zero)));
+                inside = _mm_and_ps(inside, covered);
+            }
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+            __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth);
+            __m128 stored = _mm_loadu_ps(row + x);
+            __m128 passed = _mm_and_ps(inside, _mm_cmplt_ps(depth, stored));
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(passed, depth), _mm_andnot_ps(passed, stored)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        float* row = depthBuffer + (size_t)y * stride;
+        for (int x = minX; x <= maxX; x++)
+        {
+            float px = x + 0.5f;
+            bool inside = true;
+            for (int i = 0; i < 3; i++)
+            {
+                float edge = a[i] * px + b[i] * py + c[i];
+                inside = inside && (edge > 0.0f || (edge == 0.0f && topLeft[i]));
+            }
+            float depth = za * px + zb * py + zc;
+            if (inside && depth < row[x])
+                row[x] = depth;
+        }
+    }
+#endif
+}
+
+// ------------------------------------------------------------------------
+void CpuVsm::rasterize(const std::vector<glm::vec3>& triangles)
+{
+    const int width = currentSettings.width;
+    const int height = currentSettings.height;
+    const glm::mat4 worldToClip = currentSettings.lightProjection * currentSettings.lightView;
+
+    // clip and project once, the bands share the result
+    std::vector<ScreenTriangle> screenTriangles;
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+    {
+        std::vector<glm::vec4> polygon = {worldToClip * glm::vec4(triangles[i], 1.0f), worldToClip * glm::vec4(triangles[i + 1], 1.0f), worldToClip * glm::vec4(triangles[i + 2], 1.0f)};
+        // the whole frustum, the ground plane would reach far outside the map and cost the edge functions precision
+        for (int axis = 0; axis < 3 && polygon.size() >= 3; axis++)
+        {
+            polygon = clipPolygon(polygon, [axis](const glm::vec4& v) { return v.w + v[axis]; });
+            polygon = clipPolygon(polygon, [axis](const glm::vec4& v) { return v.w - v[axis]; });
+        }
+        if (polygon.size() < 3)
+            continue;
+        std::vector<glm::vec3> window;
+        for (const glm::vec4& v : polygon)
+            window.push_back(glm::vec3((v.x / v.w * 0.5f + 0.5f) * width, (v.y / v.w * 0.5f + 0.5f) * height, v.z / v.w));
+        for (size_t j = 1; j + 1 < window.size(); j++)
+        {
+            const glm::vec3* corners[3] = {&window[0], &window[j], &window[j + 1]};
+            ScreenTriangle screen;
+            for (int k = 0; k < 3; k++)
+            {
+                screen.x[k] = corners[k]->x;
+                screen.y[k] = corners[k]->y;
+                screen.z[k] = corners[k]->z;
+            }
+            screenTriangles.push_back(screen);
+        }
+    }
+
+    const int stride = (width + 3) & ~3;
+    depthBuffer.assign((size_t)stride * height, CLEAR_DEPTH);
+    parallelFor(height, threadCount, [&](int rowBegin, int rowEnd)
+    {
+        for (const ScreenTriangle& triangle : screenTriangles)
+            rasterizeTriangle(triangle, depthBuffer.data(), stride, width, rowBegin, rowEnd);
+    });
+}
+
+void CpuVsm::blur(const MomentMap& source, MomentMap& target, bool horizontal)
+{
+    // varianceCalculate.frag reads texel centers, so each tap is one texel; the edge is clamped
+    const int width = source.width;
+    const int height = source.height;
+    const int radius = currentSettings.blurRadius;
+    parallelFor(height, threadCount, [&](int rowBegin, int rowEnd)
+    {
+        for (int y = rowBegin; y < rowEnd; y++)
+            for (int x = 0; x < width; x++)
+            {
+                glm::vec2 sum = source.texels[(size_t)y * width + x];
+                for (int i = 1; i <= radius; i++)
+                {
+                    int ax = horizontal ? std::min(x + i, width - 1) : x;
+                    int ay = horizontal ? y : std::min(y + i, height - 1);
+                    int bx = horizontal ? std::max(x - i, 0) : x;
+                    int by = horizontal ? y : std::max(y - i, 0);
+                    sum += source.texels[(size_t)ay * width + ax];
+                    sum += source.texels[(size_t)by * width + bx];
+                }
+                target.texels[(size_t)y * width + x] = sum / float(2 * radius + 1);
+            }
+    });
+    if (currentSettings.halfPrecision)
+        roundToHalf(target);
+}
+
+void CpuVsm::roundToHalf(MomentMap& map)
+{
+    for (glm::vec2& texel : map.texels)
+        texel = glm::unpackHalf2x16(glm::packHalf2x16(texel));
+}
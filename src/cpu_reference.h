@@ -0,0 +1,79 @@
+#ifndef CPU_REFERENCE_H
+#define CPU_REFERENCE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// two moments per texel, row 0 at the bottom like a GL texture
+struct MomentMap
+{
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec2> texels;
+
+    // bilinear like texture() with GL_LINEAR, (1, 1) outside like the border color of the main pass
+    glm::vec2 sample(const glm::vec2& uv) const;
+};
+
+struct CpuVsmSettings
+{
+    int width = 1024;
+    int height = 1024;
+    int blurRadius = 4;
+    float nearPlane = 0.1f;
+    float farPlane = 20.0f;
+    glm::mat4 lightView = glm::mat4(1.0f);
+    glm::mat4 lightProjection = glm::mat4(1.0f);
+    // round the moments to half floats after every pass, like a GL_RG16F variance map
+    bool halfPrecision = false;
+    // 0 uses every hardware thread
+    int threadCount = 0;
+};
+
+// The variance shadow map pipeline on the CPU, the ground truth for the GPU passes: depthShader.frag into a
+// moment map, the separable box blur of varianceCalculate.frag, and calculateShadow of mainShader.frag.
+// The light view is drawn by a half-space rasterizer that tests four pixels at a time with SSE2 where the compiler
+// targets it, with a scalar loop otherwise; each thread rasterizes every triangle into a band of rows. Triangles are
+// clipped against the frustum, pixel centers and the top-left rule follow GL.
+class CpuVsm
+{
+public:
+    explicit CpuVsm(const CpuVsmSettings& settings);
+
+    // draws the world space triangles (three positions each) from the light and blurs the moments
+    void render(const std::vector<glm::vec3>& triangles);
+
+    const MomentMap& moments() const
+    {
+        return momentMap;
+    }
+    const MomentMap& varianceMap() const
+    {
+        return blurredMap;
+    }
+    const CpuVsmSettings& settings() const
+    {
+        return currentSettings;
+    }
+
+    // visibility of a world position in [0, 1], from the blurred map or any other map of the same light
+    float shadow(const glm::vec3& worldPosition) const;
+    float shadow(const MomentMap& map, const glm::vec3& worldPosition) const;
+
+    // linearizeDepth of lightDepth.glsl
+    float linearizeDepth(float ndcDepth) const;
+
+private:
+    CpuVsmSettings currentSettings;
+    int threadCount;
+    // NDC depth of the nearest triangle per texel
+    std::vector<float> depthBuffer;
+    MomentMap momentMap;
+    MomentMap blurredMap;
+
+    void rasterize(const std::vector<glm::vec3>& triangles);
+    void blur(const MomentMap& source, MomentMap& target, bool horizontal);
+    void roundToHalf(MomentMap& map);
+};
+#endif
@@ -1,11 +1,19 @@
 #version 330 core
+#include "perVertex.glsl"
+#include "drawData.glsl"
 layout (location = 0) in vec3 aPos;
 
+#ifdef INSTANCED
+layout (location = 3) in mat4 model;
+#elif !defined(MULTI_DRAW)
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+#include "frameData.glsl"
 
 void main()
 {
+#ifdef MULTI_DRAW
+    mat4 model = draws[aDrawIndex].model;
+#endif
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
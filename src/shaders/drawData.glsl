@@ -0,0 +1,16 @@
+// per-object data of multi-draw-indirect passes, include it right after perVertex.glsl
+// aDrawIndex is baseInstance + instance of the draw command, it indexes the storage buffer
+#include "extensions.glsl"
+#ifdef MULTI_DRAW
+struct DrawData
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 material;
+};
+layout (std430, binding = 0) readonly buffer DrawDataBuffer
+{
+    DrawData draws[];
+};
+layout (location = 10) in uint aDrawIndex;
+#endif
@@ -0,0 +1,8 @@
+// #extension directives have to come before any declaration, so every permutation enables its extensions here
+#ifdef SEPARABLE_PROGRAM
+#extension GL_ARB_separate_shader_objects : enable
+#endif
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
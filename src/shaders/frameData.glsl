@@ -0,0 +1,7 @@
+// camera of the pass, written once per pass into the stream buffer (FrameData in OpenGL_VSM.cpp)
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+};
@@ -0,0 +1,7 @@
+// expects the uniforms nearPlane and farPlane of the light frustum to be declared by the including shader
+
+// maps a NDC depth in [-1, 1] to a linear depth normalized to [0, 1] between nearPlane and farPlane
+float linearizeDepth(float ndcDepth){
+    float z = (2.0*nearPlane*farPlane)/(farPlane+nearPlane-ndcDepth*(farPlane-nearPlane));
+    return (z-nearPlane)/(farPlane-nearPlane);
+}
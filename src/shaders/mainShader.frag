@@ -2,6 +2,9 @@
 in vec3 WorldPosition;
 in vec2 TexCoords;
 in vec3 Normal;
+#ifdef MULTI_DRAW
+flat in float MaterialSpec;
+#endif
 
 out vec4 FragColor;
 
@@ -22,26 +25,32 @@ struct Material{
 };
 uniform Material material;
 
-uniform vec3 cameraPosition;
+#include "frameData.glsl"
 uniform mat4 worldToLight;
 uniform float nearPlane;
 uniform float farPlane;
 uniform sampler2D varianceShadowMap;
 
+#include "lightDepth.glsl"
+
+// shadow technique of the permutation: SHADOW_VSM (default) or SHADOW_NONE
+#ifndef SHADOW_BIAS
+#define SHADOW_BIAS 0.001
+#endif
+
 float calculateShadow(float depth, vec2 uv){
+#ifdef SHADOW_NONE
+    return 1.0;
+#else
     vec2 varianceData = texture(varianceShadowMap, uv).rg;
     float var = varianceData.g - varianceData.r*varianceData.r;
-    if(depth - 0.001 <= varianceData.r){
+    if(depth - SHADOW_BIAS <= varianceData.r){
         return 1.0;
     }
     else{
         return var/(var+pow(depth-varianceData.r, 2.0));
     }
-}
-
-float linearizeDepth(float depth){
-    float z = (2.0*nearPlane*farPlane)/(farPlane+nearPlane-depth*(farPlane-nearPlane));
-    return (z-nearPlane)/(farPlane-nearPlane);
+#endif
 }
 
 void main()
@@ -63,7 +72,12 @@ void main()
 
     vec3 H = normalize(lightDirection + viewDirection);
     float NdotH = max(dot(Normal, H), 0.0);
-    vec3 specular = pow(NdotH, material.spec)*mainLight.intensity*attenuation;
+#ifdef MULTI_DRAW
+    float spec = MaterialSpec;
+#else
+    float spec = material.spec;
+#endif
+    vec3 specular = pow(NdotH, spec)*mainLight.intensity*attenuation;
 
     vec4 lightSpacePosition = worldToLight * vec4(WorldPosition, 1.0);
     lightSpacePosition.xyz=lightSpacePosition.xyz/lightSpacePosition.w;
@@ -1,4 +1,6 @@
 #version 330 core
+#include "perVertex.glsl"
+#include "drawData.glsl"
 layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec2 aTexCoords;
 layout (location = 2) in vec3 aNormal;
@@ -6,16 +8,50 @@ layout (location = 2) in vec3 aNormal;
 out vec3 WorldPosition;
 out vec2 TexCoords;
 out vec3 Normal;
+#ifdef MULTI_DRAW
+flat out float MaterialSpec;
+#endif
 
+#ifdef INSTANCED
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in mat3 aNormalMatrix;
+#elif !defined(MULTI_DRAW)
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// transpose(inverse(mat3(model))), computed once per transform on the CPU
+uniform mat3 normalMatrix;
+#endif
+#include "frameData.glsl"
+
+#ifdef PACKED_VERTICES
+// inverse of GeometryBuffer::encodeOctahedral, the lower half of the octahedron is folded over the upper one
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+#endif
 
 void main()
 {
+#if defined(MULTI_DRAW)
+    mat4 model = draws[aDrawIndex].model;
+    mat3 normalMatrix = draws[aDrawIndex].normalMatrix;
+    MaterialSpec = draws[aDrawIndex].material.x;
+#elif defined(INSTANCED)
+    mat4 model = aModel;
+    mat3 normalMatrix = aNormalMatrix;
+#endif
     vec4 worldPosition = model * vec4(aPosition, 1.0);
     WorldPosition = vec3(worldPosition);
-    Normal = mat3(transpose(inverse(model)))*aNormal;
+#ifdef PACKED_VERTICES
+    vec3 normal = decodeOctahedral(aNormal.xy);
+#else
+    vec3 normal = aNormal;
+#endif
+    Normal = normalMatrix*normal;
     TexCoords = aTexCoords;
     gl_Position = projection * view * worldPosition;
 }
\ No newline at end of file
@@ -0,0 +1,8 @@
+// separable programs have to redeclare the built-in outputs they write, include it right after #version
+#include "extensions.glsl"
+#ifdef SEPARABLE_PROGRAM
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+#endif
@@ -1,4 +1,5 @@
 #version 330 core
+#include "perVertex.glsl"
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 
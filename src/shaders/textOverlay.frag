@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+// glyph coverage of the font, one channel
+uniform sampler2D glyphTexture;
+
+void main()
+{
+    float glyph = texture(glyphTexture, TexCoords).r;
+    // the cell behind a character is darkened, so the text stays readable over a bright scene
+    FragColor = vec4(vec3(glyph), mix(0.6, 1.0, glyph));
+}
@@ -3,25 +3,38 @@ out vec2 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D depthTexture;
-uniform bool horizontal;
+
+// the blur direction and radius are compiled into each permutation
+#ifndef BLUR_RADIUS
+#define BLUR_RADIUS 4
+#endif
+
+#ifdef BLUR_HORIZONTAL
+const vec2 blurDirection = vec2(1.0, 0.0);
+#else
+const vec2 blurDirection = vec2(0.0, 1.0);
+#endif
 
 void main()
 {
-    vec2 tex_offset = 1.0 / textureSize(depthTexture, 0);
+    vec2 tex_offset = blurDirection / textureSize(depthTexture, 0);
     vec2 result = texture(depthTexture, TexCoords).rg;
-    if (horizontal)
-    {
-        for (int i=1; i<5; i++){
-            result += texture(depthTexture, TexCoords + vec2(tex_offset.x * i, 0.0)).rg;
-            result += texture(depthTexture, TexCoords - vec2(tex_offset.x * i, 0.0)).rg;
-        }
+#ifdef BLUR_LINEAR_TAPS
+    // all taps weigh the same, so two neighbouring texels are read with one bilinear fetch halfway between them
+    for (int i=1; i<BLUR_RADIUS; i+=2){
+        result += 2.0 * texture(depthTexture, TexCoords + tex_offset * (float(i) + 0.5)).rg;
+        result += 2.0 * texture(depthTexture, TexCoords - tex_offset * (float(i) + 0.5)).rg;
     }
-    else{
-        for (int i=1; i<5; i++){
-            result += texture(depthTexture, TexCoords + vec2(0.0, tex_offset.y*i)).rg;
-            result += texture(depthTexture, TexCoords - vec2(0.0, tex_offset.y*i)).rg;
-        }
+#if BLUR_RADIUS % 2 == 1
+    result += texture(depthTexture, TexCoords + tex_offset * BLUR_RADIUS).rg;
+    result += texture(depthTexture, TexCoords - tex_offset * BLUR_RADIUS).rg;
+#endif
+#else
+    for (int i=1; i<=BLUR_RADIUS; i++){
+        result += texture(depthTexture, TexCoords + tex_offset * i).rg;
+        result += texture(depthTexture, TexCoords - tex_offset * i).rg;
     }
-    result = result / 9.0;
+#endif
+    result = result / float(2*BLUR_RADIUS+1);
     FragColor = result;
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Build time tool that compiles the shader sources into the executable.
+// usage: embed_shaders <output header> <shader directory> <shader files...>
+// Every shader is preprocessed without defines, so its #include directives are resolved here, and written as
+// constexpr string data named by its path relative to the shader directory.
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "myOpenGL/shader_preprocessor.h"
+
+// MSVC limits the length of a single string literal, so long sources are split into adjacent literals
+const size_t MAX_LITERAL_LENGTH = 8192;
+const char* DELIMITER = "vsm_shader";
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: embed_shaders <output header> <shader directory> <shader files...>" << std::endl;
+        return 1;
+    }
+    std::string directory = argv[2];
+    if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+        directory += '/';
+
+    std::string header;
+    header += "// generated by embed_shaders, do not edit\n";
+    header += "#ifndef EMBEDDED_SHADERS_H\n#define EMBEDDED_SHADERS_H\n\n";
+    header += "#include <cstddef>\n\n#include \"myOpenGL/shader_preprocessor.h\"\n\n";
+    header += "constexpr EmbeddedShader EMBEDDED_SHADERS[] = {\n";
+    for (int i = 3; i < argc; i++)
+    {
+        std::string path = argv[i];
+        std::string name = path.compare(0, directory.size(), directory) == 0 ? path.substr(directory.size()) : path;
+
+        ShaderPreprocessor preprocessor;
+        std::string source;
+        if (!preprocessor.process(path, ShaderDefines(), source))
+            return 1;
+
+        header += "    {\"" + name + "\",\n";
+        for (size_t start = 0; start < source.size(); start += MAX_LITERAL_LENGTH)
+            header += std::string("        R\"") + DELIMITER + "(" + source.substr(start, MAX_LITERAL_LENGTH) + ")" + DELIMITER + "\"\n";
+        if (source.empty())
+            header += "        \"\"\n";
+        header += "    },\n";
+    }
+    header += "};\n";
+    header += "constexpr size_t EMBEDDED_SHADER_COUNT = sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]);\n\n#endif\n";
+
+    std::ofstream output(argv[1], std::ios::out | std::ios::binary);
+    output << header;
+    if (!output)
+    {
+        std::cout << "ERROR::EMBED_SHADERS::FILE_NOT_SUCCESFULLY_WRITTEN: " << argv[1] << std::endl;
+        return 1;
+    }
+    return 0;
+}
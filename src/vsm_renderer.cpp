@@ -0,0 +1,492 @@
+#include "vsm_renderer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/mesh.h"
+#include "myOpenGL/cpu_trace.h"
+#include "myOpenGL/frame_stats.h"
+#include "myOpenGL/gl_debug.h"
+#include "vsm_scene.h"
+#include "embedded_shaders.h"
+
+// material table of the scene, x: specular exponent
+static const glm::vec4 sceneMaterials[] = {glm::vec4(64.0f), glm::vec4(12.0f)};
+// camera of a pass, std140 layout of the FrameData block in frameData.glsl
+struct FrameData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 cameraPosition;
+};
+static const GLuint FRAME_DATA_BINDING = 0;
+
+VsmRenderer::VsmRenderer() : MainCamera(glm::vec3(0.0f, 2.0f, 8.0f)), shaderWatcher(shaderCache), sceneBucket(2)
+{
+}
+VsmRenderer::~VsmRenderer()
+{
+    shaderWatcher.stop();
+}
+
+bool VsmRenderer::init(const RendererSettings& settings)
+{
+    currentSettings = settings;
+    // before anything is created, so every object gets its label
+    if (settings.debugOutput)
+        GLDebug::current().enable();
+
+    // every binding, viewport and enable bit goes through the tracker so redundant changes are dropped
+    GLState::current().enable(GL_DEPTH_TEST);
+
+    // shaders are embedded in the executable, VSM_SHADER_DIR reads them from a directory instead, e.g. src/shaders for development
+    ShaderPreprocessor::setEmbeddedSources(EMBEDDED_SHADERS, EMBEDDED_SHADER_COUNT);
+    if (const char* shaderDirectory = std::getenv("VSM_SHADER_DIR"))
+        ShaderPreprocessor::setSourceDirectory(shaderDirectory);
+
+    // every (source, defines) permutation is compiled once by the cache
+    ShaderDefines blurDefines = {{"BLUR_RADIUS", std::to_string(settings.blurRadius)}};
+    if (settings.linearBlurTaps)
+        blurDefines["BLUR_LINEAR_TAPS"] = "";
+    ShaderDefines horizontalBlurDefines = blurDefines;
+    horizontalBlurDefines["BLUR_HORIZONTAL"] = "";
+    multiDraw = settings.useMultiDraw && MultiDrawBatch::supported();
+    ShaderDefines sceneDefines;
+    if (multiDraw)
+        sceneDefines["MULTI_DRAW"] = "";
+    else if (settings.useInstancing)
+        sceneDefines["INSTANCED"] = "";
+    packedVertices = settings.usePackedVertices && (multiDraw || settings.useInstancing);
+    if (packedVertices)
+        sceneDefines["PACKED_VERTICES"] = "";
+    ShaderDefines mainDefines = sceneDefines;
+    mainDefines["SHADOW_VSM"] = "";
+    depthShader = &shaderCache.get("depthShader.vert", "depthShader.frag", sceneDefines);
+    horizontalBlurShader = &shaderCache.get("screenQuad.vert", "varianceCalculate.frag", horizontalBlurDefines);
+    verticalBlurShader = &shaderCache.get("screenQuad.vert", "varianceCalculate.frag", blurDefines);
+    mainShader = &shaderCache.get("mainShader.vert", "mainShader.frag", mainDefines);
+    debugShader = &shaderCache.get("screenQuad.vert", "debugShader.frag");
+    textShader = &shaderCache.get("screenQuad.vert", "textOverlay.frag");
+
+    lightView = lightViewMatrix(LightPosition);
+    lightProjection = lightProjectionMatrix(settings.depthMapWidth, settings.depthMapHeight, LightNearPlane, LightFarPlane);
+    setStaticUniforms();
+
+    depthDrawParameters.reset(new ShaderParameters(*depthShader));
+    mainDrawParameters.reset(new ShaderParameters(*mainShader));
+
+    // scene draws are recorded into the bucket off the GL thread, sorted and then submitted per pass
+    initScene();
+    resolveMaterialSlots();
+    sceneBucket.BindMaterial = [this](ShaderParameters& parameters, uint32_t material)
+    {
+        int slot = &parameters == mainDrawParameters.get() ? mainMaterialSlot : depthMaterialSlot;
+        parameters.set(slot, sceneMaterials[material].x);
+    };
+    if (sceneCommandCount() >= WORKER_RECORDING_THRESHOLD)
+        recordingWorker.start("recording worker");
+
+    // the cameras of the passes are written into the mapped regions of a stream buffer every frame
+    GLint uniformAlignment = 16;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    frameStream.create(GL_UNIFORM_BUFFER, 4096, uniformAlignment);
+    frameStream.label("frame data stream");
+
+    statsOverlay.create();
+    // counters of the uploads above go to the first frame
+    FrameStats::current().reset();
+
+    initRenderGraph();
+    if (!renderGraph.compile())
+        return false;
+    if (settings.printStatistics)
+        renderGraph.print();
+    // the command issue of each pass goes to the CPU trace, its execution to the GPU profiler; passes do not nest,
+    // so one flag remembers whether the open pass is traced even if tracing is switched meanwhile
+    renderGraph.BeginPass = [this](const std::string& name)
+    {
+        passTraced = CpuTrace::global().enabled();
+        if (passTraced)
+            CpuTrace::global().begin(CpuTrace::global().intern(name));
+        if (currentSettings.profileGpu)
+            gpuProfiler.begin(name);
+    };
+    renderGraph.EndPass = [this](const std::string&)
+    {
+        if (currentSettings.profileGpu)
+            gpuProfiler.end();
+        if (passTraced)
+            CpuTrace::global().end();
+        passTraced = false;
+    };
+
+    // recompile programs in the background when their sources change, embedded sources never do
+    shaderWatcher.OnReload = [this]()
+    {
+        setStaticUniforms();
+        resolveMaterialSlots();
+    };
+    if (ShaderPreprocessor::readsFiles())
+        shaderWatcher.start();
+    running = true;
+    return true;
+}
+
+// a reloaded program may use the material where it did not before
+void VsmRenderer::resolveMaterialSlots()
+{
+    depthMaterialSlot = depthDrawParameters->find("material.spec");
+    mainMaterialSlot = mainDrawParameters->find("material.spec");
+}
+
+// static parameter of shader, set again whenever a program gets reloaded
+void VsmRenderer::setStaticUniforms()
+{
+    CpuTrace::Scope trace("static uniforms");
+    depthShader->use();
+    depthShader->setFloat("nearPlane", LightNearPlane);
+    depthShader->setFloat("farPlane", LightFarPlane);
+    depthShader->setUniformBlockBinding("FrameData", FRAME_DATA_BINDING);
+
+    mainShader->use();
+    mainShader->setFloat("nearPlane", LightNearPlane);
+    mainShader->setFloat("farPlane", LightFarPlane);
+    mainShader->setUniformBlockBinding("FrameData", FRAME_DATA_BINDING);
+    mainShader->setInt("varianceShadowMap", 0);
+    mainShader->setMat4("worldToLight", lightProjection*lightView);
+    mainShader->setVec3("mainLight.position", LightPosition);
+    mainShader->setVec3("mainLight.intensity", glm::vec3(2,2,2));
+    mainShader->setFloat("mainLight.constant", 1.0);
+    mainShader->setFloat("mainLight.linear", 0.2);
+    mainShader->setFloat("mainLight.quadratic", 0.005);
+    mainShader->setVec3("material.albedo", glm::vec3(0.6, 0.6, 0.6));
+
+    debugShader->use();
+    debugShader->setInt("debugTexture", 0);
+
+    horizontalBlurShader->use();
+    horizontalBlurShader->setInt("depthTexture", 0);
+    verticalBlurShader->use();
+    verticalBlurShader->setInt("depthTexture", 0);
+}
+
+// light depth and squared depth from the shadow pass, blurred in two separable passes for the main pass.
+// The moments and the blurred map never live at the same time and share a texture.
+void VsmRenderer::initRenderGraph()
+{
+    const RendererSettings& settings = currentSettings;
+    RenderTextureDesc momentsDesc = {settings.depthMapWidth, settings.depthMapHeight, settings.momentsFormat};
+    RenderGraph::Resource shadowMoments = renderGraph.createTexture("shadow moments", momentsDesc);
+    RenderGraph::Resource shadowDepth = renderGraph.createTexture("shadow depth", RenderTextureDesc{settings.depthMapWidth, settings.depthMapHeight, GL_DEPTH_COMPONENT24});
+    RenderGraph::Resource blurredRows = renderGraph.createTexture("blurred rows", momentsDesc);
+    RenderGraph::Resource varianceMap = renderGraph.createTexture("variance map", momentsDesc);
+    varianceMapResource = varianceMap;
+    RenderGraph::Resource sceneColor = renderGraph.importFramebuffer("scene", settings.outputFramebuffer, settings.width, settings.height);
+    RenderGraph::Resource debugColor = renderGraph.importFramebuffer("variance map view", settings.outputFramebuffer, settings.width, settings.height);
+
+    // shadow pass, view from the light and get the depth and squared depth
+    RenderGraph::Pass shadowPass = renderGraph.addPass("shadow", [this]()
+    {
+        GLState::current().clearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        depthShader->use();
+        frameStream.bindRange(FRAME_DATA_BINDING, shadowFrame);
+        sceneBucket.submit(SHADOW_PASS);
+    });
+    renderGraph.write(shadowPass, shadowMoments);
+    renderGraph.write(shadowPass, shadowDepth);
+
+    // calculate the average value
+    RenderGraph::Pass horizontalBlurPass = renderGraph.addPass("horizontal blur", [this]()
+    {
+        GLState::current().clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        horizontalBlurShader->use();
+        renderQuad();
+    });
+    renderGraph.read(horizontalBlurPass, shadowMoments, 0);
+    renderGraph.write(horizontalBlurPass, blurredRows);
+    RenderGraph::Pass verticalBlurPass = renderGraph.addPass("vertical blur", [this]()
+    {
+        GLState::current().clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        verticalBlurShader->use();
+        renderQuad();
+    });
+    renderGraph.read(verticalBlurPass, blurredRows, 0);
+    renderGraph.write(verticalBlurPass, varianceMap);
+
+    // render from camera view, outside the light frustum counts as lit
+    RenderGraph::Pass mainPass = renderGraph.addPass("main", [this]()
+    {
+        GLState::current().clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        mainShader->use();
+        frameStream.bindRange(FRAME_DATA_BINDING, mainFrame);
+        sceneBucket.submit(MAIN_PASS);
+    });
+    renderGraph.read(mainPass, varianceMap, 0, GL_CLAMP_TO_BORDER);
+    renderGraph.write(mainPass, sceneColor);
+
+    // debug
+    RenderGraph::Pass debugPass = renderGraph.addPass("debug", [this]()
+    {
+        GLState::current().clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        debugShader->use();
+        renderQuad();
+    });
+    renderGraph.read(debugPass, varianceMap, 0, GL_CLAMP_TO_BORDER);
+    renderGraph.write(debugPass, debugColor);
+
+    renderGraph.setOutput(settings.showVarianceMap ? debugColor : sceneColor);
+}
+
+void VsmRenderer::render()
+{
+    // reloaded programs are swapped in between two frames
+    {
+        CpuTrace::Scope trace("shader watcher update");
+        shaderWatcher.update();
+    }
+    // scopes the frame loop added after the last frame, e.g. the buffer swap, still count to that frame
+    gpuProfiler.beginFrame();
+    FrameStats::current().beginFrame();
+
+    // get camera parameters
+    view = MainCamera.GetViewMatrix();
+    projection = glm::perspective(glm::radians(MainCamera.Zoom), (float)currentSettings.width / (float)currentSettings.height, NearPlane, FarPlane);
+
+    // with enough draws the shadow pass is recorded on the worker while this thread records the main pass
+    sceneBucket.clear();
+    ScenePass shadowScene = {SHADOW_PASS, depthShader, depthDrawParameters.get(), true, lightView, LightFarPlane};
+    ScenePass mainScene = {MAIN_PASS, mainShader, mainDrawParameters.get(), false, view, FarPlane};
+    auto recordShadows = [&]()
+    {
+        CpuTrace::Scope trace("record shadow pass");
+        recordScene(1, shadowScene);
+    };
+    if (recordingWorker.running())
+        recordingWorker.run(recordShadows);
+    else
+        recordShadows();
+    {
+        CpuTrace::Scope trace("record main pass");
+        recordScene(0, mainScene);
+    }
+    if (recordingWorker.running())
+        recordingWorker.wait();
+    {
+        CpuTrace::Scope trace("sort commands");
+        sceneBucket.sort();
+    }
+
+    {
+        CpuTrace::Scope trace("frame data");
+        frameStream.beginFrame();
+        shadowFrame = frameStream.write(FrameData{lightView, lightProjection, glm::vec4(LightPosition, 1.0f)});
+        mainFrame = frameStream.write(FrameData{view, projection, glm::vec4(MainCamera.Position, 1.0f)});
+        frameStream.flush();
+    }
+    {
+        CpuTrace::Scope trace("render graph");
+        renderGraph.execute();
+    }
+    if (ShowStatsOverlay)
+        drawStatsOverlay();
+    frameStream.endFrame();
+}
+
+// the statistics of the last finished frame over the output
+void VsmRenderer::drawStatsOverlay()
+{
+    CpuTrace::Scope trace("stats overlay");
+    GLDebug::Group debugGroup("stats overlay");
+    if (currentSettings.profileGpu)
+        gpuProfiler.begin("stats overlay");
+    GLState::current().bindFramebuffer(GL_FRAMEBUFFER, currentSettings.outputFramebuffer);
+    GLState::current().viewport(0, 0, currentSettings.width, currentSettings.height);
+    statsOverlay.draw(*textShader, FrameStats::current().lines(), currentSettings.width, currentSettings.height);
+    if (currentSettings.profileGpu)
+        gpuProfiler.end();
+}
+
+std::vector<unsigned char> VsmRenderer::readPixels() const
+{
+    std::vector<unsigned char> pixels((size_t)currentSettings.width * currentSettings.height * 3);
+    GLState::current().bindFramebuffer(GL_READ_FRAMEBUFFER, currentSettings.outputFramebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, currentSettings.width, currentSettings.height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+std::vector<float> VsmRenderer::readVarianceMap() const
+{
+    std::vector<float> texels((size_t)currentSettings.depthMapWidth * currentSettings.depthMapHeight * 2);
+    GLState::current().bindTexture(0, GL_TEXTURE_2D, renderGraph.texture(varianceMapResource));
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, texels.data());
+    return texels;
+}
+
+void VsmRenderer::shutdown()
+{
+    if (!running)
+        return;
+    running = false;
+    shaderWatcher.stop();
+    recordingWorker.stop();
+    gpuProfiler.finish();
+    if (currentSettings.printStatistics)
+    {
+        GLState::current().print();
+        std::cout << "frame stats: " << FrameStats::current().summary() << std::endl;
+        std::cout << "stream buffer: " << (frameStream.Persistent ? "persistent" : "mapped per frame") << ", " << frameStream.Stalls << " frames waited for the GPU" << std::endl;
+        if (currentSettings.profileGpu)
+            gpuProfiler.print();
+        if (GLDebug::current().enabled())
+            GLDebug::current().print();
+    }
+    gpuProfiler.release();
+    statsOverlay.destroy();
+    GLDebug::current().disable();
+}
+
+void VsmRenderer::renderQuad()
+{
+    if (quadVAO == 0)
+    {
+        float quadVertices[] = {
+            // position        // uv
+            -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+            1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+            1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+        };
+        glGenVertexArrays(1, &quadVAO);
+        glGenBuffers(1, &quadVBO);
+        GLState::current().bindVertexArray(quadVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+        FrameStats::current().countUpload(sizeof(quadVertices));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
+        GLDebug::current().label(GL_VERTEX_ARRAY, quadVAO, "screen quad vertex array");
+        GLDebug::current().label(GL_BUFFER, quadVBO, "screen quad vertices");
+    }
+    GLState::current().bindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    FrameStats::current().countDraw(2);
+}
+
+// uploads the scene geometry and instances, needs the GL context
+void VsmRenderer::initScene()
+{
+    // corners shared by triangles of the same face are welded, then the triangle and vertex order is optimized
+    Mesh frameMesh = Mesh::fromTriangles(FRAME_VERTICES, FRAME_VERTEX_COUNT);
+    frameMesh.optimize();
+    Mesh planeMesh = Mesh::fromTriangles(PLANE_VERTICES, PLANE_VERTEX_COUNT);
+    planeMesh.optimize();
+
+    for (const glm::mat4& model : pillarTransforms(currentSettings.pillarCount))
+        frameInstances.add(model);
+    planeInstances.add(planeTransform());
+
+    frameGeometry.PackedVertices = packedVertices;
+    frameGeometry.addMesh(frameMesh);
+    frameGeometry.upload();
+    planeGeometry.PackedVertices = packedVertices;
+    planeGeometry.addMesh(planeMesh);
+    planeGeometry.upload();
+    frameInstances.setPositionTransform(frameGeometry.Meshes[0].positionTransform);
+    planeInstances.setPositionTransform(planeGeometry.Meshes[0].positionTransform);
+    if (currentSettings.useInstancing)
+    {
+        frameInstances.attach(frameGeometry.VAO);
+        frameInstances.attach(frameGeometry.PositionVAO);
+        planeInstances.attach(planeGeometry.VAO);
+        planeInstances.attach(planeGeometry.PositionVAO);
+    }
+    frameGeometry.label("frame");
+    planeGeometry.label("plane");
+    frameInstances.label("frame instances");
+    planeInstances.label("plane instances");
+
+    if (multiDraw)
+    {
+        sceneGeometry.PackedVertices = packedVertices;
+        int frameIndex = sceneGeometry.addMesh(frameMesh);
+        int planeIndex = sceneGeometry.addMesh(planeMesh);
+        sceneGeometry.upload();
+        sceneBatch.add(sceneGeometry.Meshes[frameIndex], frameInstances, sceneMaterials[0]);
+        sceneBatch.add(sceneGeometry.Meshes[planeIndex], planeInstances, sceneMaterials[1]);
+        sceneBatch.upload(sceneGeometry);
+        sceneGeometry.label("scene");
+        sceneBatch.label("scene batch");
+    }
+}
+
+// normalized view distance of an instance origin, the sort key draws near instances first
+static float instanceDepth(const glm::mat4& view, float farPlane, const InstanceData& instance)
+{
+    return -(view * instance.model[3]).z / farPlane;
+}
+// records every instance of a mesh, as one instanced draw when instancing is on
+void VsmRenderer::recordInstances(int thread, const ScenePass& pass, const GeometryBuffer& geometry, const InstanceBuffer& instances, uint32_t material)
+{
+    RenderCommand command = {};
+    command.shader = pass.shader;
+    command.parameters = pass.parameters;
+    command.geometry = &geometry;
+    command.mesh = 0;
+    command.positionOnly = pass.depthOnly;
+    command.material = material;
+    unsigned int vertexArray = geometry.vertexArray(pass.depthOnly);
+    if (currentSettings.useInstancing)
+    {
+        float nearest = 1.0f;
+        for (const InstanceData& instance : instances.Instances)
+            nearest = std::min(nearest, instanceDepth(pass.view, pass.farPlane, instance));
+        command.instanceCount = instances.size();
+        sceneBucket.record(thread, CommandBucket::makeKey(pass.id, *pass.shader, material, vertexArray, nearest), command);
+        return;
+    }
+    command.instanceCount = 1;
+    for (const InstanceData& instance : instances.Instances)
+    {
+        command.instance = &instance;
+        sceneBucket.record(thread, CommandBucket::makeKey(pass.id, *pass.shader, material, vertexArray, instanceDepth(pass.view, pass.farPlane, instance)), command);
+    }
+}
+// records the draws of a pass, only reads the scene so it can run on any thread
+void VsmRenderer::recordScene(int thread, const ScenePass& pass)
+{
+    if (multiDraw)
+    {
+        RenderCommand command = {};
+        command.shader = pass.shader;
+        command.parameters = pass.parameters;
+        command.geometry = &sceneGeometry;
+        command.positionOnly = pass.depthOnly;
+        command.batch = &sceneBatch;
+        sceneBucket.record(thread, CommandBucket::makeKey(pass.id, *pass.shader, 0, sceneGeometry.vertexArray(pass.depthOnly), 0.0f), command);
+        return;
+    }
+    recordInstances(thread, pass, frameGeometry, frameInstances, 0);
+    recordInstances(thread, pass, planeGeometry, planeInstances, 1);
+}
+// draws recordScene() records per pass
+int VsmRenderer::sceneCommandCount() const
+{
+    if (multiDraw)
+        return 1;
+    if (currentSettings.useInstancing)
+        return 2;
+    return frameInstances.size() + planeInstances.size();
+}
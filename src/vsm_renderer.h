@@ -0,0 +1,187 @@
+#ifndef VSM_RENDERER_H
+#define VSM_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <memory>
+#include <iostream>
+
+#include "myOpenGL/camera.h"
+#include "myOpenGL/shader.h"
+#include "myOpenGL/shader_cache.h"
+#include "myOpenGL/shader_watcher.h"
+#include "myOpenGL/shader_parameters.h"
+#include "myOpenGL/instance_buffer.h"
+#include "myOpenGL/geometry_buffer.h"
+#include "myOpenGL/multi_draw.h"
+#include "myOpenGL/command_bucket.h"
+#include "myOpenGL/render_graph.h"
+#include "myOpenGL/stream_buffer.h"
+#include "myOpenGL/gpu_profiler.h"
+#include "myOpenGL/text_overlay.h"
+#include "myOpenGL/worker_thread.h"
+
+// everything the renderer needs to know before init(), changing it later has no effect
+struct RendererSettings
+{
+    // size of the final image
+    int width = 1280;
+    int height = 720;
+    // framebuffer the final image is drawn to, 0 for the default framebuffer of a window
+    unsigned int outputFramebuffer = 0;
+    int depthMapWidth = 1024;
+    int depthMapHeight = 1024;
+    // storage of the shadow moments and the blurred map, GL_RG32F or GL_RG16F
+    GLenum momentsFormat = GL_RG32F;
+    int blurRadius = 4;
+    // read pairs of blur taps with one bilinear fetch, half the texture reads for the same box filter
+    bool linearBlurTaps = false;
+    // pillars in the scene, rows of five along x
+    int pillarCount = 5;
+    // show the blurred variance map instead of the scene, the render graph culls the pass that is not shown
+    bool showVarianceMap = false;
+    // draw repeated meshes with one instanced call, the model matrices come from an instance buffer
+    bool useInstancing = true;
+    // submit each scene pass with one glMultiDrawElementsIndirect from a shared geometry buffer where GL 4.3 is available
+    bool useMultiDraw = true;
+    // 16 byte vertices (quantized positions, half uvs, octahedral normals), the dequantization is folded into the
+    // instance model matrices, so it needs the instanced or the multi-draw path
+    bool usePackedVertices = true;
+    // time every render graph pass with GPU timestamp queries, read back a few frames later
+    bool profileGpu = true;
+    // print the GL state, render graph, stream buffer and GPU time statistics when the renderer shuts down
+    bool printStatistics = true;
+    // KHR_debug: label the GL objects, wrap the passes in debug groups and collect the driver messages; best with a
+    // debug context, needs GL 4.3
+    bool debugOutput = false;
+};
+
+// The variance shadow map demo without a window: the scene, the shadow pipeline and its resources.
+// The owner creates the GL context, loads glad and presents the frames, so the same renderer runs in a window or
+// headless into an offscreen framebuffer. Shaders come from the embedded sources unless VSM_SHADER_DIR is set.
+class VsmRenderer
+{
+public:
+    Camera MainCamera;
+    float NearPlane = 0.1f;
+    float FarPlane = 50.0f;
+
+    glm::vec3 LightPosition = glm::vec3(8.0f, 4.0f, 5.0f);
+    float LightNearPlane = 0.1f;
+    float LightFarPlane = 20.0f;
+    // frame times and counters of FrameStats over the top left corner of the frame
+    bool ShowStatsOverlay = false;
+
+    VsmRenderer();
+    ~VsmRenderer();
+
+    // compiles the shaders and uploads the scene, the context has to be current
+    bool init(const RendererSettings& settings);
+    // renders one frame into the output framebuffer
+    void render();
+    // the output framebuffer as tightly packed RGB rows, bottom row first
+    std::vector<unsigned char> readPixels() const;
+    // the blurred moments of the last frame, two floats per texel, bottom row first
+    std::vector<float> readVarianceMap() const;
+    // stops the shader watcher and prints the statistics, the context has to be current still
+    void shutdown();
+
+    const RendererSettings& settings() const
+    {
+        return currentSettings;
+    }
+    // GPU times of the passes, the frame loop can add scopes of its own, e.g. around the buffer swap
+    GpuProfiler& profiler()
+    {
+        return gpuProfiler;
+    }
+    // the shadow pipeline, e.g. for hooks around its passes
+    RenderGraph& graph()
+    {
+        return renderGraph;
+    }
+    // whether the scene passes are drawn with glMultiDrawElementsIndirect
+    bool multiDrawEnabled() const
+    {
+        return multiDraw;
+    }
+
+private:
+    // passes of the scene command bucket, in submission order
+    enum
+    {
+        SHADOW_PASS,
+        MAIN_PASS
+    };
+    // the shadow pass is recorded on a worker from this many draws per pass, below that the hand-off costs more than
+    // the recording
+    static const int WORKER_RECORDING_THRESHOLD = 256;
+    // a pass over the scene, depth-only passes read nothing but the position stream of the meshes
+    struct ScenePass
+    {
+        unsigned int id;
+        Shader* shader;
+        ShaderParameters* parameters;
+        bool depthOnly;
+        glm::mat4 view;
+        float farPlane;
+    };
+
+    RendererSettings currentSettings;
+    bool multiDraw = false;
+    bool packedVertices = false;
+    bool running = false;
+    // the render graph pass being executed went to the CPU trace
+    bool passTraced = false;
+
+    ShaderCache shaderCache;
+    ShaderWatcher shaderWatcher;
+    Shader* depthShader = nullptr;
+    Shader* horizontalBlurShader = nullptr;
+    Shader* verticalBlurShader = nullptr;
+    Shader* mainShader = nullptr;
+    Shader* debugShader = nullptr;
+    Shader* textShader = nullptr;
+    // per-draw uniforms of the scene, only the ones each program uses are written
+    std::unique_ptr<ShaderParameters> depthDrawParameters;
+    std::unique_ptr<ShaderParameters> mainDrawParameters;
+    // slots of the material uniform in the draw parameters, resolved again after a reload
+    int depthMaterialSlot = -1;
+    int mainMaterialSlot = -1;
+
+    GeometryBuffer frameGeometry;
+    GeometryBuffer planeGeometry;
+    InstanceBuffer frameInstances;
+    InstanceBuffer planeInstances;
+    GeometryBuffer sceneGeometry;
+    MultiDrawBatch sceneBatch;
+    unsigned int quadVAO = 0;
+    unsigned int quadVBO = 0;
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 lightView;
+    glm::mat4 lightProjection;
+    CommandBucket sceneBucket;
+    WorkerThread recordingWorker;
+    StreamBuffer frameStream;
+    StreamAllocation shadowFrame;
+    StreamAllocation mainFrame;
+    RenderGraph renderGraph;
+    RenderGraph::Resource varianceMapResource = -1;
+    GpuProfiler gpuProfiler;
+    TextOverlay statsOverlay;
+
+    void setStaticUniforms();
+    void resolveMaterialSlots();
+    void initScene();
+    void initRenderGraph();
+    void recordInstances(int thread, const ScenePass& pass, const GeometryBuffer& geometry, const InstanceBuffer& instances, uint32_t material);
+    void recordScene(int thread, const ScenePass& pass);
+    int sceneCommandCount() const;
+    void renderQuad();
+    void drawStatsOverlay();
+};
+#endif
@@ -0,0 +1,100 @@
+#include "vsm_scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// a pillar, 0.25 x 2 x 0.25
+const float FRAME_VERTICES[] = {
+    // position         // uv       // normal
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f,
+    0.0f, 0.0f, 0.25f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f,
+    0.25f, 0.0f, 0.25f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f,
+    0.25f, 0.0f, 0.25f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f,
+    0.25f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f,
+
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+    0.0f, 2.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f,
+    0.0f, 2.0f, 0.25f, 1.0f, 1.0f, -1.0f, 0.0f, 0.0f,
+    0.0f, 2.0f, 0.25f, 1.0f, 1.0f, -1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 0.25f, 1.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f,
+    0.25f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f,
+    0.25f, 2.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f,
+    0.25f, 2.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f,
+    0.0f, 2.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f,
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f,
+
+    0.0f, 0.0f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    0.25f, 0.0f, 0.25f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+    0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+    0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+    0.0f, 2.0f, 0.25f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+
+    0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+    0.25f, 2.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+    0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+    0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+    0.25f, 0.0f, 0.25f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+    0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+
+    0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 2.0f, 0.25f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+    0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+    0.25f, 2.0f, 0.25f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+    0.25f, 2.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+};
+// the ground
+const float PLANE_VERTICES[] = {
+    -100.0f, 0.0f, -100.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+    100.0f, 0.0f, 100.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+    -100.0f, 0.0f, 100.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+    -100.0f, 0.0f, -100.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+    100.0f, 0.0f, -100.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+    100.0f, 0.0f, 100.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+};
+
+std::vector<glm::mat4> pillarTransforms(int pillarCount)
+{
+    std::vector<glm::mat4> transforms;
+    for (int i=0; i<pillarCount; i++){
+        // further rows go behind the first one
+        glm::vec3 offset = glm::vec3(2.0f * (i % 5), 0.0f, -2.0f * (i / 5));
+        transforms.push_back(glm::translate(glm::mat4(1.0), offset));
+    }
+    return transforms;
+}
+
+glm::mat4 planeTransform()
+{
+    return glm::translate(glm::mat4(1.0), glm::vec3(0.0, 0.001, 0.0));
+}
+
+glm::mat4 lightViewMatrix(const glm::vec3& lightPosition)
+{
+    return glm::lookAt(lightPosition, LIGHT_TARGET, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+glm::mat4 lightProjectionMatrix(int depthMapWidth, int depthMapHeight, float nearPlane, float farPlane)
+{
+    return glm::perspective(glm::radians(90.0f), (float)depthMapWidth / (float)depthMapHeight, nearPlane, farPlane);
+}
+
+static void appendTriangles(std::vector<glm::vec3>& triangles, const float* vertices, int vertexCount, const glm::mat4& model)
+{
+    for (int i = 0; i < vertexCount; i++)
+    {
+        const float* vertex = vertices + i * SCENE_VERTEX_FLOATS;
+        triangles.push_back(glm::vec3(model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f)));
+    }
+}
+std::vector<glm::vec3> sceneTriangles(int pillarCount)
+{
+    std::vector<glm::vec3> triangles;
+    for (const glm::mat4& model : pillarTransforms(pillarCount))
+        appendTriangles(triangles, FRAME_VERTICES, FRAME_VERTEX_COUNT, model);
+    appendTriangles(triangles, PLANE_VERTICES, PLANE_VERTEX_COUNT, planeTransform());
+    return triangles;
+}
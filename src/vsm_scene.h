@@ -0,0 +1,29 @@
+#ifndef VSM_SCENE_H
+#define VSM_SCENE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// The demo scene without any GL: pillars standing on a ground plane, lit by a spot light looking at LIGHT_TARGET.
+// The GPU renderer uploads it, the CPU reference rasterizes the same triangles.
+
+// interleaved triangle list vertices: position, uv, normal
+const int SCENE_VERTEX_FLOATS = 8;
+extern const float FRAME_VERTICES[];
+const int FRAME_VERTEX_COUNT = 36;
+extern const float PLANE_VERTICES[];
+const int PLANE_VERTEX_COUNT = 6;
+
+const glm::vec3 LIGHT_TARGET = glm::vec3(6.0f, 1.0f, 0.0f);
+
+// model matrices of the pillars, rows of five along x
+std::vector<glm::mat4> pillarTransforms(int pillarCount);
+glm::mat4 planeTransform();
+
+glm::mat4 lightViewMatrix(const glm::vec3& lightPosition);
+glm::mat4 lightProjectionMatrix(int depthMapWidth, int depthMapHeight, float nearPlane, float farPlane);
+
+// world space positions of every triangle of the scene, three per triangle
+std::vector<glm::vec3> sceneTriangles(int pillarCount);
+#endif